@@ -0,0 +1,62 @@
+// Speaker position names for explicit channel maps, shared by the noise CLI and the
+// web server. Include after miniaudio.h.
+#ifndef ALGORYTHM_CHANNEL_MAP_H
+#define ALGORYTHM_CHANNEL_MAP_H
+
+#include <stdlib.h>
+#include <string.h>
+
+// Accepts "FL", "FR", "FC", "LFE", "BL", "BR", "FLC", "FRC", "BC", "SL", "SR", "TC",
+// "TFL", "TFC", "TFR", "TBL", "TBC", "TBR", "MONO", "NONE" and "AUX0".."AUX31".
+// Returns 0 on success.
+static inline int channel_from_name(const char* name, ma_channel* out) {
+    static const struct { const char* name; ma_channel channel; } kNames[] = {
+        { "NONE", MA_CHANNEL_NONE }, { "MONO", MA_CHANNEL_MONO },
+        { "FL", MA_CHANNEL_FRONT_LEFT }, { "FR", MA_CHANNEL_FRONT_RIGHT },
+        { "FC", MA_CHANNEL_FRONT_CENTER }, { "LFE", MA_CHANNEL_LFE },
+        { "BL", MA_CHANNEL_BACK_LEFT }, { "BR", MA_CHANNEL_BACK_RIGHT },
+        { "FLC", MA_CHANNEL_FRONT_LEFT_CENTER }, { "FRC", MA_CHANNEL_FRONT_RIGHT_CENTER },
+        { "BC", MA_CHANNEL_BACK_CENTER }, { "SL", MA_CHANNEL_SIDE_LEFT },
+        { "SR", MA_CHANNEL_SIDE_RIGHT }, { "TC", MA_CHANNEL_TOP_CENTER },
+        { "TFL", MA_CHANNEL_TOP_FRONT_LEFT }, { "TFC", MA_CHANNEL_TOP_FRONT_CENTER },
+        { "TFR", MA_CHANNEL_TOP_FRONT_RIGHT }, { "TBL", MA_CHANNEL_TOP_BACK_LEFT },
+        { "TBC", MA_CHANNEL_TOP_BACK_CENTER }, { "TBR", MA_CHANNEL_TOP_BACK_RIGHT },
+    };
+    for (size_t i = 0; i < sizeof(kNames) / sizeof(kNames[0]); ++i) {
+        if (strcmp(name, kNames[i].name) == 0) {
+            *out = kNames[i].channel;
+            return 0;
+        }
+    }
+    if (strncmp(name, "AUX", 3) == 0 && name[3] >= '0' && name[3] <= '9') {
+        char* end = NULL;
+        long n = strtol(name + 3, &end, 10);
+        if (*end == '\0' && n >= 0 && n < 32) {
+            *out = (ma_channel)(MA_CHANNEL_AUX_0 + n);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Parse a comma separated list such as "FL,FR,FC,LFE". Returns the number of entries,
+// or -1 if a name is unknown or there are more than cap.
+static inline int channel_map_parse(const char* list, ma_channel* map, ma_uint32 cap) {
+    ma_uint32 count = 0;
+    const char* p = list;
+    while (*p) {
+        const char* end = strchr(p, ',');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        char name[8];
+        if (len == 0 || len >= sizeof(name) || count >= cap) return -1;
+        memcpy(name, p, len);
+        name[len] = '\0';
+        if (channel_from_name(name, &map[count]) != 0) return -1;
+        count++;
+        p += len;
+        if (*p == ',') p++;
+    }
+    return (int)count;
+}
+
+#endif
@@ -0,0 +1,981 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L // posix_memalign
+#endif
+
+#include "dsp.h"
+#include "dsp_kernels.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__linux__) && defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#define DSP_PI 3.14159265358979323846
+
+// Runtime kernel selection. Every path renders bit-identical noise, so the choice only
+// affects speed; levels sums may differ in the last bits.
+static const DspKernels* g_kernels;
+
+static const char* const kPathNames[] = { "scalar", "sse2", "avx2", "neon" };
+
+static const DspKernels* kernels_for_path(DspPath path) {
+    switch (path) {
+    case DSP_PATH_SCALAR: return &dsp_kernels_scalar;
+#if defined(DSP_HAVE_SSE2_KERNELS)
+    case DSP_PATH_SSE2: return &dsp_kernels_sse2;
+#endif
+#if defined(DSP_HAVE_AVX2_KERNELS)
+    case DSP_PATH_AVX2: return &dsp_kernels_avx2;
+#endif
+#if defined(DSP_HAVE_NEON_KERNELS)
+    case DSP_PATH_NEON: return &dsp_kernels_neon;
+#endif
+    default: return NULL;
+    }
+}
+
+static int cpu_has_avx2(void) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return 0;
+    __cpuid(info, 1);
+    // OSXSAVE and AVX, then the OS must save the YMM state.
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) return 0;
+    if ((_xgetbv(0) & 6) != 6) return 0;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return 0;
+#endif
+}
+
+static int cpu_has_neon(void) {
+#if defined(__linux__) && defined(__aarch64__)
+    return (getauxval(AT_HWCAP) & HWCAP_ASIMD) != 0;
+#else
+    // Advanced SIMD is part of the AArch64 baseline.
+    return 1;
+#endif
+}
+
+int dsp_path_supported(DspPath path) {
+    if (!kernels_for_path(path)) return 0;
+    if (path == DSP_PATH_AVX2) return cpu_has_avx2();
+    if (path == DSP_PATH_NEON) return cpu_has_neon();
+    return 1;
+}
+
+static DspPath best_path(void) {
+    if (dsp_path_supported(DSP_PATH_AVX2)) return DSP_PATH_AVX2;
+    if (dsp_path_supported(DSP_PATH_NEON)) return DSP_PATH_NEON;
+    if (dsp_path_supported(DSP_PATH_SSE2)) return DSP_PATH_SSE2;
+    return DSP_PATH_SCALAR;
+}
+
+int dsp_path_from_name(const char* name, DspPath* out) {
+    for (int i = 0; i < DSP_PATH_COUNT; ++i) {
+        if (strcmp(name, kPathNames[i]) == 0) {
+            *out = (DspPath)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char* dsp_path_name(DspPath path) {
+    return (unsigned)path < DSP_PATH_COUNT ? kPathNames[path] : "unknown";
+}
+
+int dsp_set_path(DspPath path) {
+    if (!dsp_path_supported(path)) return -1;
+    g_kernels = kernels_for_path(path);
+    return 0;
+}
+
+int dsp_init(void) {
+    g_kernels = kernels_for_path(best_path());
+    const char* forced = getenv("ALGORYTHM_DSP_PATH");
+    if (!forced || !*forced) return 0;
+    DspPath path;
+    if (dsp_path_from_name(forced, &path) != 0) return -1;
+    return dsp_set_path(path);
+}
+
+static const DspKernels* kernels(void) {
+    if (!g_kernels) dsp_init();
+    return g_kernels;
+}
+
+DspPath dsp_active_path(void) {
+    return kernels()->path;
+}
+
+static uint64_t splitmix64(uint64_t* x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+void dsp_noise_init(DspNoise* st, DspNoiseColor color, uint32_t seed) {
+    memset(st, 0, sizeof(*st));
+    st->color = color;
+    uint64_t x = seed;
+    for (uint32_t c = 0; c < DSP_MAX_CHANNELS; ++c) {
+        st->lanes[c] = (uint32_t)(splitmix64(&x) >> 32);
+    }
+}
+
+void dsp_noise_render_planar_f32(DspNoise* st, float* const* planes, size_t frames, uint32_t channels, float amp) {
+    kernels()->noise_render_planar(st, planes, frames, channels, amp);
+}
+
+void dsp_interleave_f32(const float* const* planes, const float* gains, float* out, size_t frames, uint32_t channels) {
+    kernels()->interleave(planes, gains, out, frames, channels);
+}
+
+void dsp_channel_gains_f32(float* samples, size_t frames, uint32_t channels, const float* gains) {
+    kernels()->channel_gains(samples, frames, channels, gains);
+}
+
+void dsp_noise_render_f32(DspNoise* st, float* out, size_t frames, uint32_t channels, float amp, const float* gains) {
+    // Planar generation in cache-sized chunks, then one vectorized interleave pass.
+    enum { kChunk = 64 };
+    float scratch[DSP_MAX_CHANNELS * kChunk];
+    float* planes[DSP_MAX_CHANNELS];
+    for (uint32_t c = 0; c < channels; ++c) planes[c] = scratch + (size_t)c * kChunk;
+    for (size_t done = 0; done < frames;) {
+        size_t n = frames - done < kChunk ? frames - done : kChunk;
+        dsp_noise_render_planar_f32(st, planes, n, channels, amp);
+        dsp_interleave_f32((const float* const*)planes, gains, out + done * channels, n, channels);
+        done += n;
+    }
+}
+
+#define DSP_Q30(x) ((int32_t)((x) * 1073741824.0 + ((x) < 0 ? -0.5 : 0.5)))
+
+// a * x + b * y in Q30 arithmetic, rounded.
+static inline int32_t q30_mac2(int32_t a, int32_t x, int32_t b, int32_t y) {
+    return (int32_t)(((int64_t)a * x + (int64_t)b * y + (1 << 29)) >> 30);
+}
+
+static inline int16_t saturate_s16(int64_t v) {
+    return (int16_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+}
+
+void dsp_noise_render_s16(DspNoise* st, int16_t* out, size_t frames, uint32_t channels, int32_t ampQ15, const int32_t* gainsQ15) {
+    // The float filters' constants, in Q30.
+    static const int32_t kPinkPole[6] = {
+        DSP_Q30(0.99886), DSP_Q30(0.99332), DSP_Q30(0.96900), DSP_Q30(0.86650), DSP_Q30(0.55000), DSP_Q30(-0.7616)
+    };
+    static const int32_t kPinkIn[6] = {
+        DSP_Q30(0.0555179), DSP_Q30(0.0750759), DSP_Q30(0.1538520), DSP_Q30(0.3104856), DSP_Q30(0.5329522), DSP_Q30(-0.0168980)
+    };
+    const int32_t pinkDirect = DSP_Q30(0.5362), pinkLast = DSP_Q30(0.115926), pinkScale = DSP_Q30(0.11);
+    const int32_t brownPole = DSP_Q30(1.0 / 1.02), brownIn = DSP_Q30(0.02 / 1.02);
+    // One channel at a time so its state lives in registers for the whole block.
+    for (uint32_t c = 0; c < channels; ++c) {
+        const int32_t gain = gainsQ15 ? (int32_t)(((int64_t)ampQ15 * gainsQ15[c] + (1 << 14)) >> 15) : ampQ15;
+        uint32_t s = st->lanes[c];
+        int32_t b[7];
+        for (int k = 0; k < 7; ++k) b[k] = st->pinkFixed[k][c];
+        int32_t brown = st->brownFixed[c];
+        int16_t* o = out + c;
+        for (size_t f = 0; f < frames; ++f) {
+            s = s * DSP_LCG_MUL + DSP_LCG_ADD;
+            // High 16 bits as a uniform Q15 sample in [-1, 1), widened to Q23.
+            int32_t w = ((int32_t)(s >> 16) - 32768) * 256;
+            int32_t y;
+            switch (st->color) {
+            case DSP_NOISE_PINK: {
+                for (int k = 0; k < 6; ++k) b[k] = q30_mac2(kPinkPole[k], b[k], kPinkIn[k], w);
+                int64_t p = (int64_t)b[0] + b[1] + b[2] + b[3] + b[4] + b[5] + b[6];
+                p += ((int64_t)pinkDirect * w + (1 << 29)) >> 30;
+                b[6] = (int32_t)(((int64_t)pinkLast * w + (1 << 29)) >> 30);
+                y = (int32_t)((p * pinkScale + (1 << 29)) >> 30);
+                break;
+            }
+            case DSP_NOISE_BROWN:
+                brown = q30_mac2(brownPole, brown, brownIn, w);
+                y = (int32_t)(((int64_t)brown * 7 + 1) >> 1); // * 3.5
+                break;
+            default:
+                y = w;
+                break;
+            }
+            o[f * channels] = saturate_s16(((int64_t)y * gain + (1 << 22)) >> 23);
+        }
+        st->lanes[c] = s;
+        for (int k = 0; k < 7; ++k) st->pinkFixed[k][c] = b[k];
+        st->brownFixed[c] = brown;
+    }
+}
+
+int32_t dsp_gain_ramp_s16(int16_t* samples, size_t frames, uint32_t channels, int32_t gain, int32_t step, int32_t target) {
+    for (size_t f = 0; f < frames; ++f) {
+        if (step != 0) {
+            gain += step;
+            if ((step > 0 && gain >= target) || (step < 0 && gain <= target)) {
+                gain = target;
+                step = 0;
+            }
+        }
+        int16_t* frame = samples + f * channels;
+        for (uint32_t c = 0; c < channels; ++c) frame[c] = saturate_s16(((int64_t)frame[c] * gain + (1 << 29)) >> 30);
+    }
+    return gain;
+}
+
+int dsp_noise_color_from_name(const char* name, DspNoiseColor* out) {
+    if (strcmp(name, "white") == 0) { *out = DSP_NOISE_WHITE; return 0; }
+    if (strcmp(name, "pink") == 0) { *out = DSP_NOISE_PINK; return 0; }
+    if (strcmp(name, "brown") == 0) { *out = DSP_NOISE_BROWN; return 0; }
+    return -1;
+}
+
+void dsp_f32_to_s16(const float* in, int16_t* out, size_t n) {
+    kernels()->f32_to_s16(in, out, n);
+}
+
+static const int16_t kImaStepTable[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int8_t kImaIndexTable[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+uint32_t dsp_ima_adpcm_samples_per_block(uint32_t blockAlign, uint32_t channels) {
+    return (blockAlign / channels - 4) * 2 + 1;
+}
+
+void dsp_ima_adpcm_init(DspImaAdpcm* st) {
+    memset(st, 0, sizeof(*st));
+}
+
+// Branch-free quantizer step so the per-channel lanes compile to selects.
+static inline uint8_t ima_encode_sample(int32_t* predictor, int32_t* index, int32_t sample) {
+    int32_t step = kImaStepTable[*index];
+    int32_t diff = sample - *predictor;
+    int32_t sign = diff < 0 ? 8 : 0;
+    diff = diff < 0 ? -diff : diff;
+    int32_t vpdiff = step >> 3;
+    int32_t b2 = diff >= step;
+    diff -= b2 ? step : 0;
+    vpdiff += b2 ? step : 0;
+    int32_t b1 = diff >= (step >> 1);
+    diff -= b1 ? (step >> 1) : 0;
+    vpdiff += b1 ? (step >> 1) : 0;
+    int32_t b0 = diff >= (step >> 2);
+    vpdiff += b0 ? (step >> 2) : 0;
+    int32_t p = *predictor + (sign ? -vpdiff : vpdiff);
+    p = p > 32767 ? 32767 : (p < -32768 ? -32768 : p);
+    int32_t code = (b2 << 2) | (b1 << 1) | b0 | sign;
+    int32_t idx = *index + kImaIndexTable[code];
+    idx = idx < 0 ? 0 : (idx > 88 ? 88 : idx);
+    *predictor = p;
+    *index = idx;
+    return (uint8_t)code;
+}
+
+void dsp_ima_adpcm_encode_block(DspImaAdpcm* st, const int16_t* in, uint32_t channels, uint32_t samplesPerBlock, uint8_t* out) {
+    // Per-channel header: the first sample verbatim plus the current step index.
+    for (uint32_t c = 0; c < channels; ++c) {
+        int16_t first = in[c];
+        st->predictor[c] = first;
+        out[0] = (uint8_t)(first & 0xFF);
+        out[1] = (uint8_t)((first >> 8) & 0xFF);
+        out[2] = (uint8_t)st->index[c];
+        out[3] = 0;
+        out += 4;
+    }
+    // Body: per channel, 4-byte words of 8 nibbles (low nibble first), channels interleaved.
+    uint8_t codes[8][DSP_MAX_CHANNELS];
+    for (uint32_t s = 1; s < samplesPerBlock; s += 8) {
+        for (uint32_t k = 0; k < 8; ++k) {
+            const int16_t* frame = in + (size_t)(s + k) * channels;
+            for (uint32_t c = 0; c < channels; ++c) {
+                codes[k][c] = ima_encode_sample(&st->predictor[c], &st->index[c], frame[c]);
+            }
+        }
+        for (uint32_t c = 0; c < channels; ++c) {
+            for (uint32_t k = 0; k < 8; k += 2) {
+                *out++ = (uint8_t)(codes[k][c] | (codes[k + 1][c] << 4));
+            }
+        }
+    }
+}
+
+float dsp_gain_ramp_f32(float* samples, size_t frames, uint32_t channels, float gain, float step, float target) {
+    return kernels()->gain_ramp(samples, frames, channels, gain, step, target);
+}
+
+void dsp_levels_f32(const float* samples, size_t n, DspLevels* out) {
+    kernels()->levels(samples, n, out);
+}
+
+void* dsp_aligned_alloc(size_t bytes) {
+    if (bytes == 0) bytes = 64;
+#if defined(_WIN32)
+    return _aligned_malloc(bytes, 64);
+#else
+    void* p = NULL;
+    if (posix_memalign(&p, 64, bytes) != 0) return NULL;
+    return p;
+#endif
+}
+
+void dsp_aligned_free(void* p) {
+#if defined(_WIN32)
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+void dsp_window_hann(float* w, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        w[i] = (float)(0.5 - 0.5 * cos(2.0 * DSP_PI * (double)i / (double)n));
+    }
+}
+
+int dsp_fft_init(DspFft* fft, size_t n) {
+    memset(fft, 0, sizeof(*fft));
+    if (n < 2 || (n & (n - 1)) != 0) return -1;
+    unsigned bits = 0;
+    while (((size_t)1 << bits) < n) bits++;
+    fft->n = n;
+    fft->bitrev = (uint32_t*)dsp_aligned_alloc(n * sizeof(uint32_t));
+    fft->cosTable = (float*)dsp_aligned_alloc((n / 2) * sizeof(float));
+    fft->sinTable = (float*)dsp_aligned_alloc((n / 2) * sizeof(float));
+    if (!fft->bitrev || !fft->cosTable || !fft->sinTable) {
+        dsp_fft_free(fft);
+        return -1;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t r = 0;
+        for (unsigned b = 0; b < bits; ++b) {
+            if (i & ((size_t)1 << b)) r |= 1u << (bits - 1 - b);
+        }
+        fft->bitrev[i] = r;
+    }
+    for (size_t i = 0; i < n / 2; ++i) {
+        double a = 2.0 * DSP_PI * (double)i / (double)n;
+        fft->cosTable[i] = (float)cos(a);
+        fft->sinTable[i] = (float)sin(a);
+    }
+    return 0;
+}
+
+void dsp_fft_free(DspFft* fft) {
+    dsp_aligned_free(fft->bitrev);
+    dsp_aligned_free(fft->cosTable);
+    dsp_aligned_free(fft->sinTable);
+    memset(fft, 0, sizeof(*fft));
+}
+
+void dsp_fft(const DspFft* fft, float* re, float* im, int inverse) {
+    const size_t n = fft->n;
+    for (size_t i = 0; i < n; ++i) {
+        size_t j = fft->bitrev[i];
+        if (j > i) {
+            float t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+    const float sign = inverse ? 1.0f : -1.0f;
+    for (size_t len = 2; len <= n; len <<= 1) {
+        size_t half = len >> 1;
+        size_t step = n / len;
+        for (size_t base = 0; base < n; base += len) {
+            for (size_t k = 0; k < half; ++k) {
+                float wr = fft->cosTable[k * step];
+                float wi = sign * fft->sinTable[k * step];
+                size_t a = base + k;
+                size_t b = a + half;
+                float xr = re[b] * wr - im[b] * wi;
+                float xi = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - xr;
+                im[b] = im[a] - xi;
+                re[a] += xr;
+                im[a] += xi;
+            }
+        }
+    }
+}
+
+// Forward FFT of two real blocks packed as x1 + j*x2, split into the first bins of each
+// spectrum using the conjugate symmetry of real signals.
+static void conv_forward_pair(const DspFft* fft, float* re, float* im, uint32_t bins, float* re1, float* im1, float* re2, float* im2) {
+    const uint32_t n = (uint32_t)fft->n;
+    dsp_fft(fft, re, im, 0);
+    for (uint32_t k = 0; k < bins; ++k) {
+        uint32_t m = (n - k) & (n - 1);
+        float ar = re[k], ai = im[k];
+        float br = re[m], bi = -im[m]; // conj(Z[n - k])
+        re1[k] = 0.5f * (ar + br);
+        im1[k] = 0.5f * (ai + bi);
+        if (re2) {
+            re2[k] = 0.5f * (ai - bi);
+            im2[k] = -0.5f * (ar - br);
+        }
+    }
+}
+
+int dsp_conv_ir_init(DspConvIr* ir, const float* samples, size_t frames, uint32_t channels, uint32_t blockSize) {
+    memset(ir, 0, sizeof(*ir));
+    if (channels == 0 || frames == 0 || blockSize < 4 || (blockSize & (blockSize - 1))) return -1;
+    ir->blockSize = blockSize;
+    ir->fftSize = blockSize * 2;
+    ir->bins = blockSize + 1;
+    ir->partitions = (uint32_t)((frames + blockSize - 1) / blockSize);
+    ir->channels = channels;
+    size_t spectrum = (size_t)channels * ir->partitions * ir->bins;
+    ir->re = (float*)dsp_aligned_alloc(spectrum * sizeof(float));
+    ir->im = (float*)dsp_aligned_alloc(spectrum * sizeof(float));
+    float* re = (float*)dsp_aligned_alloc(ir->fftSize * sizeof(float));
+    float* im = (float*)dsp_aligned_alloc(ir->fftSize * sizeof(float));
+    if (!ir->re || !ir->im || !re || !im || dsp_fft_init(&ir->fft, ir->fftSize) != 0) {
+        dsp_aligned_free(re);
+        dsp_aligned_free(im);
+        dsp_conv_ir_free(ir);
+        return -1;
+    }
+    for (uint32_t c = 0; c < channels; ++c) {
+        for (uint32_t p = 0; p < ir->partitions; ++p) {
+            memset(re, 0, ir->fftSize * sizeof(float));
+            memset(im, 0, ir->fftSize * sizeof(float));
+            size_t start = (size_t)p * blockSize;
+            for (uint32_t i = 0; i < blockSize && start + i < frames; ++i) re[i] = samples[(start + i) * channels + c];
+            size_t off = ((size_t)c * ir->partitions + p) * ir->bins;
+            conv_forward_pair(&ir->fft, re, im, ir->bins, ir->re + off, ir->im + off, NULL, NULL);
+        }
+    }
+    dsp_aligned_free(re);
+    dsp_aligned_free(im);
+    return 0;
+}
+
+void dsp_conv_ir_free(DspConvIr* ir) {
+    dsp_aligned_free(ir->re);
+    dsp_aligned_free(ir->im);
+    if (ir->fft.n) dsp_fft_free(&ir->fft);
+    memset(ir, 0, sizeof(*ir));
+}
+
+int dsp_convolver_init(DspConvolver* cv, const DspConvIr* ir, uint32_t channels) {
+    memset(cv, 0, sizeof(*cv));
+    cv->ir = ir;
+    cv->channels = channels;
+    size_t fdl = (size_t)channels * ir->partitions * ir->bins;
+    cv->input = (float*)dsp_aligned_alloc((size_t)channels * ir->fftSize * sizeof(float));
+    cv->output = (float*)dsp_aligned_alloc((size_t)channels * ir->blockSize * sizeof(float));
+    cv->fdlRe = (float*)dsp_aligned_alloc(fdl * sizeof(float));
+    cv->fdlIm = (float*)dsp_aligned_alloc(fdl * sizeof(float));
+    cv->workRe = (float*)dsp_aligned_alloc(ir->fftSize * sizeof(float));
+    cv->workIm = (float*)dsp_aligned_alloc(ir->fftSize * sizeof(float));
+    cv->accRe = (float*)dsp_aligned_alloc(2 * ir->bins * sizeof(float));
+    cv->accIm = (float*)dsp_aligned_alloc(2 * ir->bins * sizeof(float));
+    if (!cv->input || !cv->output || !cv->fdlRe || !cv->fdlIm || !cv->workRe || !cv->workIm || !cv->accRe || !cv->accIm) {
+        dsp_convolver_free(cv);
+        return -1;
+    }
+    memset(cv->input, 0, (size_t)channels * ir->fftSize * sizeof(float));
+    memset(cv->output, 0, (size_t)channels * ir->blockSize * sizeof(float));
+    memset(cv->fdlRe, 0, fdl * sizeof(float));
+    memset(cv->fdlIm, 0, fdl * sizeof(float));
+    return 0;
+}
+
+void dsp_convolver_free(DspConvolver* cv) {
+    dsp_aligned_free(cv->input);
+    dsp_aligned_free(cv->output);
+    dsp_aligned_free(cv->fdlRe);
+    dsp_aligned_free(cv->fdlIm);
+    dsp_aligned_free(cv->workRe);
+    dsp_aligned_free(cv->workIm);
+    dsp_aligned_free(cv->accRe);
+    dsp_aligned_free(cv->accIm);
+    memset(cv, 0, sizeof(*cv));
+}
+
+// Convolve the block that just filled for channels c and c + 1 (or c alone).
+static void conv_block_pair(DspConvolver* cv, uint32_t c, int pair) {
+    const DspConvIr* ir = cv->ir;
+    const uint32_t n = ir->fftSize, bins = ir->bins, B = ir->blockSize, P = ir->partitions;
+    const DspKernels* kern = kernels();
+    const float* x1 = cv->input + (size_t)c * n;
+    const float* x2 = pair ? x1 + n : NULL;
+    memcpy(cv->workRe, x1, n * sizeof(float));
+    if (pair) memcpy(cv->workIm, x2, n * sizeof(float));
+    else memset(cv->workIm, 0, n * sizeof(float));
+
+    size_t slot = (size_t)cv->fdlPos * bins;
+    float* fr1 = cv->fdlRe + (size_t)c * P * bins;
+    float* fi1 = cv->fdlIm + (size_t)c * P * bins;
+    float* fr2 = pair ? fr1 + (size_t)P * bins : NULL;
+    float* fi2 = pair ? fi1 + (size_t)P * bins : NULL;
+    conv_forward_pair(&ir->fft, cv->workRe, cv->workIm, bins, fr1 + slot, fi1 + slot, pair ? fr2 + slot : NULL, pair ? fi2 + slot : NULL);
+
+    for (int j = 0; j <= pair; ++j) {
+        float* accRe = cv->accRe + (size_t)j * bins;
+        float* accIm = cv->accIm + (size_t)j * bins;
+        const float* fr = j ? fr2 : fr1;
+        const float* fi = j ? fi2 : fi1;
+        size_t irOff = (size_t)((c + (uint32_t)j) % ir->channels) * P * bins;
+        memset(accRe, 0, bins * sizeof(float));
+        memset(accIm, 0, bins * sizeof(float));
+        for (uint32_t p = 0; p < P; ++p) {
+            size_t x = (size_t)((cv->fdlPos + P - p) % P) * bins;
+            size_t h = irOff + (size_t)p * bins;
+            kern->cmac(accRe, accIm, fr + x, fi + x, ir->re + h, ir->im + h, bins);
+        }
+    }
+
+    // Rebuild full spectra Y1 + j*Y2 so one inverse FFT yields both real outputs.
+    const float* y1r = cv->accRe;
+    const float* y1i = cv->accIm;
+    const float* y2r = cv->accRe + bins;
+    const float* y2i = cv->accIm + bins;
+    for (uint32_t k = 0; k < n; ++k) {
+        uint32_t m = k < bins ? k : n - k;
+        float s = k < bins ? 1.0f : -1.0f; // conjugate for the mirrored half
+        float ar = y1r[m], ai = s * y1i[m];
+        float br = pair ? y2r[m] : 0.0f, bi = pair ? s * y2i[m] : 0.0f;
+        cv->workRe[k] = ar - bi;
+        cv->workIm[k] = ai + br;
+    }
+    dsp_fft(&ir->fft, cv->workRe, cv->workIm, 1);
+    const float scale = 1.0f / (float)n;
+    float* o1 = cv->output + (size_t)c * B;
+    for (uint32_t i = 0; i < B; ++i) o1[i] = cv->workRe[B + i] * scale;
+    if (pair) {
+        float* o2 = o1 + B;
+        for (uint32_t i = 0; i < B; ++i) o2[i] = cv->workIm[B + i] * scale;
+    }
+}
+
+void dsp_convolver_process_f32(DspConvolver* cv, float* samples, size_t frames, float wet, float dry) {
+    const DspConvIr* ir = cv->ir;
+    const uint32_t channels = cv->channels, n = ir->fftSize, B = ir->blockSize;
+    for (size_t f = 0; f < frames; ++f) {
+        float* frame = samples + f * channels;
+        for (uint32_t c = 0; c < channels; ++c) {
+            float x = frame[c];
+            cv->input[(size_t)c * n + B + cv->fill] = x;
+            frame[c] = dry * x + wet * cv->output[(size_t)c * B + cv->fill];
+        }
+        if (++cv->fill < B) continue;
+        for (uint32_t c = 0; c < channels; c += 2) conv_block_pair(cv, c, c + 1 < channels);
+        for (uint32_t c = 0; c < channels; ++c) {
+            float* in = cv->input + (size_t)c * n;
+            memcpy(in, in + B, B * sizeof(float));
+        }
+        cv->fdlPos = (cv->fdlPos + 1) % ir->partitions;
+        cv->fill = 0;
+    }
+}
+
+void dsp_log_bin_edges(uint32_t* edges, size_t bins, size_t fftSize, float sampleRate, float minHz) {
+    const double nyquist = sampleRate * 0.5;
+    const double hzPerBin = sampleRate / (double)fftSize;
+    if (minHz < hzPerBin) minHz = (float)hzPerBin;
+    const double ratio = log(nyquist / minHz);
+    uint32_t prev = 0;
+    for (size_t i = 0; i <= bins; ++i) {
+        double hz = minHz * exp(ratio * (double)i / (double)bins);
+        uint32_t e = (uint32_t)(hz / hzPerBin + 0.5);
+        if (e > fftSize / 2) e = (uint32_t)(fftSize / 2);
+        // Each band covers at least one FFT bin.
+        if (i > 0 && e <= prev) e = prev + 1;
+        edges[i] = e;
+        prev = e;
+    }
+}
+
+void dsp_power_to_log_bins_db(const float* power, const uint32_t* edges, size_t bins, float* outDb) {
+    for (size_t b = 0; b < bins; ++b) {
+        float peak = 1e-12f;
+        for (uint32_t k = edges[b]; k < edges[b + 1]; ++k) {
+            if (power[k] > peak) peak = power[k];
+        }
+        outDb[b] = 10.0f * log10f(peak);
+    }
+}
+
+static uint32_t gcd_u32(uint32_t a, uint32_t b) {
+    while (b) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// Zeroth-order modified Bessel function of the first kind, for the Kaiser window.
+static double bessel_i0(double x) {
+    double sum = 1.0, term = 1.0, q = x * x / 4.0;
+    for (int k = 1; k < 50 && term > sum * 1e-12; ++k) {
+        term *= q / ((double)k * (double)k);
+        sum += term;
+    }
+    return sum;
+}
+
+#define DSP_RESAMPLER_HALF_TAPS 16 // at unity ratio; scaled up when downsampling
+#define DSP_RESAMPLER_KAISER_BETA 8.6
+#define DSP_RESAMPLER_CHUNK 1024
+
+int dsp_resampler_init(DspResampler* rs, uint32_t inRate, uint32_t outRate, uint32_t channels) {
+    memset(rs, 0, sizeof(*rs));
+    if (inRate == 0 || outRate == 0 || channels == 0) return -1;
+    uint32_t g = gcd_u32(inRate, outRate);
+    rs->channels = channels;
+    rs->up = outRate / g;
+    rs->down = inRate / g;
+    rs->phases = rs->up <= DSP_RESAMPLER_MAX_PHASES ? rs->up : DSP_RESAMPLER_MAX_PHASES;
+
+    // Cutoff in cycles per input sample, a little under the lower Nyquist.
+    double scale = outRate < inRate ? (double)outRate / (double)inRate : 1.0;
+    double cutoff = 0.5 * scale * 0.95;
+    uint32_t half = (uint32_t)ceil(DSP_RESAMPLER_HALF_TAPS / scale);
+    if (half > 256) half = 256;
+    rs->taps = (2 * half + 3) & ~3u;
+    rs->table = (float*)dsp_aligned_alloc((size_t)(rs->phases + 1) * rs->taps * sizeof(float));
+    rs->capacity = rs->taps + DSP_RESAMPLER_CHUNK;
+    rs->buf = (float*)dsp_aligned_alloc((size_t)channels * rs->capacity * sizeof(float));
+    if (!rs->table || !rs->buf) {
+        dsp_resampler_free(rs);
+        return -1;
+    }
+
+    // Row p holds the kernel for an output p / phases of an input frame past the frame
+    // under tap half - 1, so tap k weights input (start + k).
+    const double i0beta = bessel_i0(DSP_RESAMPLER_KAISER_BETA);
+    for (uint32_t p = 0; p <= rs->phases; ++p) {
+        float* row = rs->table + (size_t)p * rs->taps;
+        double frac = (double)p / (double)rs->phases;
+        for (uint32_t k = 0; k < rs->taps; ++k) {
+            double d = (double)k - (double)(half - 1) - frac;
+            double r = d / (double)half;
+            double v = 0.0;
+            if (r > -1.0 && r < 1.0) {
+                double x = 2.0 * cutoff * d;
+                double sinc = fabs(x) < 1e-12 ? 1.0 : sin(DSP_PI * x) / (DSP_PI * x);
+                v = 2.0 * cutoff * sinc * bessel_i0(DSP_RESAMPLER_KAISER_BETA * sqrt(1.0 - r * r)) / i0beta;
+            }
+            row[k] = (float)v;
+        }
+    }
+    // Prime with silence so the first output is centred on the first input frame.
+    memset(rs->buf, 0, (size_t)channels * rs->capacity * sizeof(float));
+    rs->len = half - 1;
+    return 0;
+}
+
+void dsp_resampler_free(DspResampler* rs) {
+    dsp_aligned_free(rs->table);
+    dsp_aligned_free(rs->buf);
+    rs->table = NULL;
+    rs->buf = NULL;
+}
+
+size_t dsp_resampler_process_f32(DspResampler* rs, const float* in, size_t inFrames, size_t* inUsed, float* out, size_t outCap) {
+    const uint32_t channels = rs->channels, taps = rs->taps;
+    const DspKernels* kern = kernels();
+    size_t used = 0, produced = 0;
+    while (produced < outCap) {
+        if (rs->start + taps > rs->len) {
+            if (used == inFrames) break;
+            // Slide the live history to the front and append a chunk of new input.
+            uint32_t keep = rs->len - rs->start;
+            size_t take = inFrames - used;
+            if (take > rs->capacity - keep) take = rs->capacity - keep;
+            for (uint32_t c = 0; c < channels; ++c) {
+                float* b = rs->buf + (size_t)c * rs->capacity;
+                memmove(b, b + rs->start, keep * sizeof(float));
+                const float* src = in + used * channels + c;
+                for (size_t f = 0; f < take; ++f) b[keep + f] = src[f * channels];
+            }
+            rs->len = keep + (uint32_t)take;
+            rs->start = 0;
+            used += take;
+            continue;
+        }
+        // Position within the phase table; exact when phases == up.
+        uint64_t scaled = rs->acc * rs->phases;
+        uint32_t p = (uint32_t)(scaled / rs->up);
+        float w = (float)(scaled % rs->up) / (float)rs->up;
+        const float* h0 = rs->table + (size_t)p * taps;
+        float* frame = out + produced * channels;
+        for (uint32_t c = 0; c < channels; ++c) {
+            const float* x = rs->buf + (size_t)c * rs->capacity + rs->start;
+            float y = kern->dot(x, h0, taps);
+            if (w != 0.0f) y += w * (kern->dot(x, h0 + taps, taps) - y);
+            frame[c] = y;
+        }
+        produced++;
+        rs->acc += rs->down;
+        rs->start += (uint32_t)(rs->acc / rs->up);
+        rs->acc %= rs->up;
+    }
+    *inUsed = used;
+    return produced;
+}
+
+int dsp_limiter_init(DspLimiter* lim, uint32_t sampleRate, uint32_t channels, float lookaheadMs, float releaseMs, float ceiling) {
+    memset(lim, 0, sizeof(*lim));
+    uint32_t lookahead = (uint32_t)(lookaheadMs * 0.001f * (float)sampleRate + 0.5f);
+    if (lookahead < 1) lookahead = 1;
+    uint32_t window = lookahead + 1;
+    lim->channels = channels;
+    lim->lookahead = lookahead;
+    lim->ceiling = ceiling;
+    lim->release = (float)(1.0 - exp(-1.0 / (releaseMs * 0.001 * (double)sampleRate)));
+    lim->delay = (float*)dsp_aligned_alloc((size_t)lookahead * channels * sizeof(float));
+    lim->dequeValue = (float*)dsp_aligned_alloc(window * sizeof(float));
+    lim->dequeFrame = (uint64_t*)dsp_aligned_alloc(window * sizeof(uint64_t));
+    lim->box = (float*)dsp_aligned_alloc(window * sizeof(float));
+    if (!lim->delay || !lim->dequeValue || !lim->dequeFrame || !lim->box) {
+        dsp_limiter_free(lim);
+        return -1;
+    }
+    dsp_limiter_reset(lim);
+    return 0;
+}
+
+void dsp_limiter_free(DspLimiter* lim) {
+    dsp_aligned_free(lim->delay);
+    dsp_aligned_free(lim->dequeValue);
+    dsp_aligned_free(lim->dequeFrame);
+    dsp_aligned_free(lim->box);
+    lim->delay = NULL;
+    lim->dequeValue = NULL;
+    lim->dequeFrame = NULL;
+    lim->box = NULL;
+}
+
+void dsp_limiter_reset(DspLimiter* lim) {
+    uint32_t window = lim->lookahead + 1;
+    memset(lim->delay, 0, (size_t)lim->lookahead * lim->channels * sizeof(float));
+    lim->delayPos = 0;
+    lim->dequeHead = 0;
+    lim->dequeCount = 0;
+    for (uint32_t i = 0; i < window; ++i) lim->box[i] = 1.0f;
+    lim->boxPos = 0;
+    lim->boxSum = (double)window;
+    lim->gain = 1.0f;
+    lim->frame = 0;
+}
+
+void dsp_limiter_set_ceiling(DspLimiter* lim, float ceiling) {
+    lim->ceiling = ceiling;
+}
+
+float dsp_limiter_process_f32(DspLimiter* lim, float* samples, size_t frames) {
+    const uint32_t channels = lim->channels;
+    const uint32_t window = lim->lookahead + 1;
+    const float ceiling = lim->ceiling;
+    float minGain = 1.0f;
+    for (size_t f = 0; f < frames; ++f) {
+        float* frame = samples + f * channels;
+        float peak = 0.0f;
+        for (uint32_t c = 0; c < channels; ++c) {
+            float a = fabsf(frame[c]);
+            if (a > peak) peak = a;
+        }
+        float need = peak > ceiling ? ceiling / peak : 1.0f;
+
+        // Sliding minimum over the last window frames: expire the head once it leaves the
+        // window, drop larger entries from the tail, then append. Expiring first keeps at
+        // most window - 1 entries before the append, so the ring never overwrites the head.
+        if (lim->dequeCount > 0 && lim->dequeFrame[lim->dequeHead] + window <= lim->frame) {
+            lim->dequeHead = (lim->dequeHead + 1) % window;
+            lim->dequeCount--;
+        }
+        while (lim->dequeCount > 0) {
+            uint32_t tail = (lim->dequeHead + lim->dequeCount - 1) % window;
+            if (lim->dequeValue[tail] < need) break;
+            lim->dequeCount--;
+        }
+        uint32_t slot = (lim->dequeHead + lim->dequeCount) % window;
+        lim->dequeValue[slot] = need;
+        lim->dequeFrame[slot] = lim->frame;
+        lim->dequeCount++;
+        float held = lim->dequeValue[lim->dequeHead];
+
+        // Box-average the held minimum so the gain ramps down across the lookahead.
+        lim->boxSum += (double)held - (double)lim->box[lim->boxPos];
+        lim->box[lim->boxPos] = held;
+        if (++lim->boxPos == window) {
+            // Resum once per window so rounding cannot accumulate.
+            lim->boxPos = 0;
+            lim->boxSum = 0.0;
+            for (uint32_t i = 0; i < window; ++i) lim->boxSum += lim->box[i];
+        }
+        float target = (float)(lim->boxSum / (double)window);
+        if (target < lim->gain) lim->gain = target;
+        else lim->gain += (target - lim->gain) * lim->release;
+        if (lim->gain < minGain) minGain = lim->gain;
+
+        float* delayed = lim->delay + (size_t)lim->delayPos * channels;
+        for (uint32_t c = 0; c < channels; ++c) {
+            float y = delayed[c] * lim->gain;
+            delayed[c] = frame[c];
+            // Guard against rounding in the averaged gain.
+            frame[c] = y > ceiling ? ceiling : (y < -ceiling ? -ceiling : y);
+        }
+        if (++lim->delayPos == lim->lookahead) lim->delayPos = 0;
+        lim->frame++;
+    }
+    return minGain;
+}
+
+static double loudness_from_energy(double meanSquare) {
+    if (meanSquare <= 0.0) return DSP_LOUDNESS_FLOOR;
+    double l = -0.691 + 10.0 * log10(meanSquare);
+    return l < DSP_LOUDNESS_FLOOR ? DSP_LOUDNESS_FLOOR : l;
+}
+
+void dsp_loudness_init(DspLoudness* m, uint32_t sampleRate, uint32_t channels, const float* weights) {
+    memset(m, 0, sizeof(*m));
+    m->channels = channels > DSP_LOUDNESS_MAX_CHANNELS ? DSP_LOUDNESS_MAX_CHANNELS : channels;
+    for (uint32_t c = 0; c < m->channels; ++c) m->weights[c] = weights ? weights[c] : 1.0;
+    m->subBlockFrames = sampleRate / 10;
+    if (m->subBlockFrames == 0) m->subBlockFrames = 1;
+
+    // K-weighting pre-filter (high shelf) and RLB highpass, redesigned for sampleRate from
+    // the analog prototypes behind the 48 kHz coefficients in BS.1770.
+    double fs = (double)sampleRate;
+    double K = tan(DSP_PI * 1681.974450955533 / fs);
+    double Q = 0.7071752369554196;
+    double Vh = pow(10.0, 3.999843853973347 / 20.0);
+    double Vb = pow(Vh, 0.4996667741545416);
+    double a0 = 1.0 + K / Q + K * K;
+    m->k[0][0] = (Vh + Vb * K / Q + K * K) / a0;
+    m->k[0][1] = 2.0 * (K * K - Vh) / a0;
+    m->k[0][2] = (Vh - Vb * K / Q + K * K) / a0;
+    m->k[0][3] = 2.0 * (K * K - 1.0) / a0;
+    m->k[0][4] = (1.0 - K / Q + K * K) / a0;
+
+    K = tan(DSP_PI * 38.13547087602444 / fs);
+    Q = 0.5003270373238773;
+    a0 = 1.0 + K / Q + K * K;
+    m->k[1][0] = 1.0;
+    m->k[1][1] = -2.0;
+    m->k[1][2] = 1.0;
+    m->k[1][3] = 2.0 * (K * K - 1.0) / a0;
+    m->k[1][4] = (1.0 - K / Q + K * K) / a0;
+}
+
+void dsp_loudness_reset(DspLoudness* m) {
+    memset(m->z, 0, sizeof(m->z));
+    m->subBlockPos = 0;
+    m->subBlockSum = 0.0;
+    memset(m->subBlocks, 0, sizeof(m->subBlocks));
+    m->subBlockCount = 0;
+    memset(m->histCount, 0, sizeof(m->histCount));
+    memset(m->histEnergy, 0, sizeof(m->histEnergy));
+}
+
+// Mean square of the last n sub-blocks (n <= subBlockCount).
+static double loudness_window_energy(const DspLoudness* m, uint32_t n) {
+    double sum = 0.0;
+    for (uint32_t i = 0; i < n; ++i) {
+        sum += m->subBlocks[(m->subBlockCount - 1 - i) % DSP_LOUDNESS_SHORT_TERM_BLOCKS];
+    }
+    return sum / ((double)n * (double)m->subBlockFrames);
+}
+
+static void loudness_finish_sub_block(DspLoudness* m) {
+    m->subBlocks[m->subBlockCount % DSP_LOUDNESS_SHORT_TERM_BLOCKS] = m->subBlockSum;
+    m->subBlockCount++;
+    m->subBlockSum = 0.0;
+    m->subBlockPos = 0;
+    if (m->subBlockCount < 4) return;
+    // A 400 ms gating block ends every 100 ms (75% overlap).
+    double e = loudness_window_energy(m, 4);
+    double l = loudness_from_energy(e);
+    if (l <= -70.0) return;
+    int bin = (int)((l + 70.0) * 10.0);
+    if (bin >= DSP_LOUDNESS_HISTOGRAM_BINS) bin = DSP_LOUDNESS_HISTOGRAM_BINS - 1;
+    m->histCount[bin]++;
+    m->histEnergy[bin] += e;
+}
+
+void dsp_loudness_add_f32(DspLoudness* m, const float* samples, size_t frames) {
+    const uint32_t channels = m->channels;
+    for (size_t f = 0; f < frames; ++f) {
+        const float* frame = samples + f * channels;
+        double sum = 0.0;
+        for (uint32_t c = 0; c < channels; ++c) {
+            double x = frame[c];
+            for (int s = 0; s < 2; ++s) {
+                const double* k = m->k[s];
+                double y = k[0] * x + m->z[s][0][c];
+                m->z[s][0][c] = k[1] * x - k[3] * y + m->z[s][1][c];
+                m->z[s][1][c] = k[2] * x - k[4] * y;
+                x = y;
+            }
+            sum += m->weights[c] * x * x;
+        }
+        m->subBlockSum += sum;
+        if (++m->subBlockPos == m->subBlockFrames) loudness_finish_sub_block(m);
+    }
+}
+
+double dsp_loudness_momentary(const DspLoudness* m) {
+    uint32_t n = m->subBlockCount < 4 ? (uint32_t)m->subBlockCount : 4;
+    return n ? loudness_from_energy(loudness_window_energy(m, n)) : DSP_LOUDNESS_FLOOR;
+}
+
+double dsp_loudness_short_term(const DspLoudness* m) {
+    uint32_t n = m->subBlockCount < DSP_LOUDNESS_SHORT_TERM_BLOCKS ? (uint32_t)m->subBlockCount : DSP_LOUDNESS_SHORT_TERM_BLOCKS;
+    return n ? loudness_from_energy(loudness_window_energy(m, n)) : DSP_LOUDNESS_FLOOR;
+}
+
+double dsp_loudness_integrated(const DspLoudness* m) {
+    double energy = 0.0;
+    uint64_t count = 0;
+    for (int b = 0; b < DSP_LOUDNESS_HISTOGRAM_BINS; ++b) {
+        energy += m->histEnergy[b];
+        count += m->histCount[b];
+    }
+    if (count == 0) return DSP_LOUDNESS_FLOOR;
+    // Relative gate: drop blocks more than 10 LU below the absolute-gated mean.
+    double gate = loudness_from_energy(energy / (double)count) - 10.0;
+    int first = gate <= -70.0 ? 0 : (int)((gate + 70.0) * 10.0);
+    energy = 0.0;
+    count = 0;
+    for (int b = first; b < DSP_LOUDNESS_HISTOGRAM_BINS; ++b) {
+        energy += m->histEnergy[b];
+        count += m->histCount[b];
+    }
+    return count ? loudness_from_energy(energy / (double)count) : DSP_LOUDNESS_FLOOR;
+}
+
+uint64_t dsp_fnv1a64(uint64_t hash, const void* data, size_t bytes) {
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < bytes; ++i) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
@@ -0,0 +1,295 @@
+// Shared DSP kernels used by the noise CLI and the web server.
+#ifndef ALGORYTHM_DSP_H
+#define ALGORYTHM_DSP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DSP_MAX_CHANNELS 64
+
+// Instruction set paths for the hot kernels (noise generators, interleaving and gains,
+// s16 conversion, levels, convolution and resampling).
+typedef enum DspPath {
+    DSP_PATH_SCALAR = 0,
+    DSP_PATH_SSE2,
+    DSP_PATH_AVX2,
+    DSP_PATH_NEON,
+    DSP_PATH_COUNT
+} DspPath;
+
+// Detect CPU features and bind the fastest supported path, or the one named by the
+// ALGORYTHM_DSP_PATH environment variable ("scalar", "sse2", "avx2", "neon") when set.
+// Returns -1 if that name is unknown or not supported here, leaving the fastest path
+// bound. Call once before starting audio threads; the first kernel call does it
+// otherwise. Every path renders bit-identical noise.
+int dsp_init(void);
+// Switch paths, e.g. to benchmark them; not while other threads run kernels. Returns -1
+// if the path is not built in or the CPU lacks it.
+int dsp_set_path(DspPath path);
+int dsp_path_supported(DspPath path);
+DspPath dsp_active_path(void);
+const char* dsp_path_name(DspPath path);
+// Parse "scalar", "sse2", "avx2" or "neon". Returns 0 on success.
+int dsp_path_from_name(const char* name, DspPath* out);
+
+typedef enum DspNoiseColor {
+    DSP_NOISE_WHITE = 0,
+    DSP_NOISE_PINK,
+    DSP_NOISE_BROWN
+} DspNoiseColor;
+
+// Noise generator state. Every channel has its own LCG lane (seeded through splitmix64)
+// and filter memory, stored lane-major so one SIMD register holds the same field for
+// four adjacent channels.
+typedef struct DspNoise {
+    DspNoiseColor color;
+    uint32_t lanes[DSP_MAX_CHANNELS];
+    float pink[7][DSP_MAX_CHANNELS];
+    float brown[DSP_MAX_CHANNELS];
+    int32_t pinkFixed[7][DSP_MAX_CHANNELS]; // Q23 filter memory of dsp_noise_render_s16
+    int32_t brownFixed[DSP_MAX_CHANNELS];
+} DspNoise;
+
+void dsp_noise_init(DspNoise* st, DspNoiseColor color, uint32_t seed);
+// Render frames of interleaved noise scaled by amp, then by gains[channel] when gains is
+// not NULL (0 mutes a channel). channels <= DSP_MAX_CHANNELS.
+// Output is bit-identical for the same color, seed, channels and amp regardless of how
+// frames are split across calls or whether the SIMD or scalar path runs; the library is
+// built with -ffp-contract=off so no build fuses the filter arithmetic differently.
+void dsp_noise_render_f32(DspNoise* st, float* out, size_t frames, uint32_t channels, float amp, const float* gains);
+// Render into one buffer per channel. dsp_noise_render_f32 is this plus dsp_interleave_f32.
+void dsp_noise_render_planar_f32(DspNoise* st, float* const* planes, size_t frames, uint32_t channels, float amp);
+// Fixed-point twin of dsp_noise_render_f32 for targets without a fast FPU: integer-only
+// generators and filters writing s16 directly. Filter memory is Q23 and coefficients
+// Q30, with 64-bit products. ampQ15 and gainsQ15 (NULL for unity) are Q15 with 32768 as
+// 1.0. It draws the same LCG sequence as the float path, so white noise matches the
+// float render converted to s16 within one step; pink and brown differ by quantization.
+// Use one of the two renderers per DspNoise, since each keeps its own filter memory.
+void dsp_noise_render_s16(DspNoise* st, int16_t* out, size_t frames, uint32_t channels, int32_t ampQ15, const int32_t* gainsQ15);
+// Parse "white", "pink" or "brown". Returns 0 on success.
+int dsp_noise_color_from_name(const char* name, DspNoiseColor* out);
+
+// Interleave per-channel buffers into frames, scaling by gains[channel] (NULL for unity).
+void dsp_interleave_f32(const float* const* planes, const float* gains, float* out, size_t frames, uint32_t channels);
+// Scale each channel of interleaved frames in place by gains[channel].
+void dsp_channel_gains_f32(float* samples, size_t frames, uint32_t channels, const float* gains);
+
+// Convert with saturation to signed 16-bit.
+void dsp_f32_to_s16(const float* in, int16_t* out, size_t n);
+
+// IMA-ADPCM encoder for WAV format 0x11. State carries across blocks per channel.
+typedef struct DspImaAdpcm {
+    int32_t predictor[DSP_MAX_CHANNELS];
+    int32_t index[DSP_MAX_CHANNELS];
+} DspImaAdpcm;
+
+// Samples per channel in a block of blockAlign bytes: (blockAlign / channels - 4) * 2 + 1.
+uint32_t dsp_ima_adpcm_samples_per_block(uint32_t blockAlign, uint32_t channels);
+void dsp_ima_adpcm_init(DspImaAdpcm* st);
+// Encode samplesPerBlock interleaved s16 frames into one blockAlign-sized block.
+void dsp_ima_adpcm_encode_block(DspImaAdpcm* st, const int16_t* in, uint32_t channels, uint32_t samplesPerBlock, uint8_t* out);
+
+// Multiply interleaved frames by a per-frame linear gain ramp that moves by step until it
+// reaches target, then holds. Returns the gain after the last frame.
+float dsp_gain_ramp_f32(float* samples, size_t frames, uint32_t channels, float gain, float step, float target);
+
+// s16 version of dsp_gain_ramp_f32 with Q30 gain, step and target (1 << 30 is 1.0),
+// saturating. Returns the gain after the last frame.
+int32_t dsp_gain_ramp_s16(int16_t* samples, size_t frames, uint32_t channels, int32_t gain, int32_t step, int32_t target);
+#define DSP_Q15_ONE 32768
+#define DSP_Q30_ONE (1 << 30)
+
+// Per-block level statistics of an f32 buffer.
+typedef struct DspLevels {
+    float sumSquares;
+    float peak;         // max |x|
+    uint32_t clipCount; // samples with |x| >= 1
+} DspLevels;
+
+// Compute levels over n interleaved samples (SSE2/NEON when available). peak and
+// clipCount are exact on every path; the vector paths sum squares in parallel lanes, so
+// for device-sized blocks (up to some 10k samples) sumSquares may differ from the scalar
+// sum by a relative DSP_LEVELS_SUM_TOLERANCE.
+#define DSP_LEVELS_SUM_TOLERANCE 1e-4f
+void dsp_levels_f32(const float* samples, size_t n, DspLevels* out);
+
+// 64-byte aligned allocation for SIMD buffers; release with dsp_aligned_free.
+void* dsp_aligned_alloc(size_t bytes);
+void dsp_aligned_free(void* p);
+
+// Periodic Hann window of length n.
+void dsp_window_hann(float* w, size_t n);
+
+// Radix-2 complex FFT plan with precomputed twiddles and bit-reversal table.
+typedef struct DspFft {
+    size_t n;
+    uint32_t* bitrev;
+    float* cosTable; // n/2 entries
+    float* sinTable; // n/2 entries
+} DspFft;
+
+// n must be a power of two. Returns 0 on success.
+int dsp_fft_init(DspFft* fft, size_t n);
+void dsp_fft_free(DspFft* fft);
+// In-place transform of split re/im arrays. The inverse is unscaled.
+void dsp_fft(const DspFft* fft, float* re, float* im, int inverse);
+
+// Uniformly partitioned overlap-save convolution. An impulse response is cut into
+// blockSize-frame partitions whose spectra are computed once in dsp_conv_ir_init; the IR
+// is immutable afterwards and may back any number of convolvers on other threads. Each
+// convolver keeps a frequency-domain delay line of its recent input blocks, so every
+// block costs one forward FFT, partitions complex multiply-adds and one inverse FFT per
+// channel pair, whatever the IR length.
+typedef struct DspConvIr {
+    uint32_t blockSize;  // B frames per partition
+    uint32_t fftSize;    // 2B
+    uint32_t bins;       // B + 1 stored bins of the real spectrum
+    uint32_t partitions;
+    uint32_t channels;   // IR channels; output channel c uses IR channel c % channels
+    DspFft fft;
+    float* re;           // [channel][partition][bins]
+    float* im;
+} DspConvIr;
+
+// samples holds frames of interleaved IR. blockSize must be a power of two. Returns 0 on
+// success; release with dsp_conv_ir_free.
+int dsp_conv_ir_init(DspConvIr* ir, const float* samples, size_t frames, uint32_t channels, uint32_t blockSize);
+void dsp_conv_ir_free(DspConvIr* ir);
+
+typedef struct DspConvolver {
+    const DspConvIr* ir;
+    uint32_t channels;
+    uint32_t fill;   // frames of the current block collected so far
+    uint32_t fdlPos; // delay line slot of the newest input spectrum
+    float* input;    // [channel][fftSize]: previous block then current block
+    float* output;   // [channel][blockSize]: wet output of the last finished block
+    float* fdlRe;    // [channel][partition][bins]
+    float* fdlIm;
+    float* workRe;   // fftSize scratch
+    float* workIm;
+    float* accRe;    // [2][bins] accumulators for a channel pair
+    float* accIm;
+} DspConvolver;
+
+// Returns 0 on success; release with dsp_convolver_free. ir must outlive the convolver.
+int dsp_convolver_init(DspConvolver* cv, const DspConvIr* ir, uint32_t channels);
+void dsp_convolver_free(DspConvolver* cv);
+// Mix dry * x plus wet * (x convolved with the IR) in place. The wet signal lags by the
+// IR block size, which acts as a short pre-delay.
+void dsp_convolver_process_f32(DspConvolver* cv, float* samples, size_t frames, float wet, float dry);
+
+// Fill bins + 1 FFT bin edges spaced logarithmically from minHz to Nyquist.
+void dsp_log_bin_edges(uint32_t* edges, size_t bins, size_t fftSize, float sampleRate, float minHz);
+// Reduce power spectrum to per-band peak power in dB using edges from dsp_log_bin_edges.
+void dsp_power_to_log_bins_db(const float* power, const uint32_t* edges, size_t bins, float* outDb);
+
+// Polyphase windowed-sinc sample rate converter for interleaved f32. The rate ratio is
+// reduced to out/in = L/M; with L up to DSP_RESAMPLER_MAX_PHASES every output lands
+// exactly on one of L precomputed filter phases, otherwise neighbouring phases of a
+// finer table are blended. The Kaiser-windowed kernel cuts off just below the lower
+// Nyquist frequency and widens when downsampling. Dot products run four taps at a time
+// with SSE2/NEON. Output is aligned with input: frame 0 out sits at frame 0 in.
+#define DSP_RESAMPLER_MAX_PHASES 1024
+
+typedef struct DspResampler {
+    uint32_t channels;
+    uint32_t up;      // L
+    uint32_t down;    // M
+    uint32_t phases;  // table rows minus one
+    uint32_t taps;    // per row, a multiple of 4
+    float* table;     // (phases + 1) * taps
+    float* buf;       // [channel][capacity] planar input history
+    uint32_t capacity;
+    uint32_t len;     // frames held in buf
+    uint32_t start;   // first input frame under the current output's kernel
+    uint64_t acc;     // fractional position, numerator over up
+} DspResampler;
+
+// Returns 0 on success; release with dsp_resampler_free.
+int dsp_resampler_init(DspResampler* rs, uint32_t inRate, uint32_t outRate, uint32_t channels);
+void dsp_resampler_free(DspResampler* rs);
+// Convert as much as possible: reads up to inFrames, writes up to outCap frames. Returns
+// the frames written; *inUsed receives the frames read. Call again with more input when
+// it reads everything, or with more room when it fills out.
+size_t dsp_resampler_process_f32(DspResampler* rs, const float* in, size_t inFrames, size_t* inUsed, float* out, size_t outCap);
+
+// Lookahead brickwall limiter on interleaved frames. Each frame's required gain (ceiling
+// over its peak across channels, linked so the image does not shift) goes through a
+// sliding-window minimum kept in a monotonic deque, then a box filter of the same length,
+// so the gain has fully dropped by the time the delayed peak is output. Rising gain then
+// recovers with a one-pole release. Latency is lookahead frames.
+typedef struct DspLimiter {
+    uint32_t channels;
+    uint32_t lookahead; // frames of delay; the window spans lookahead + 1 frames
+    float ceiling;      // linear
+    float release;      // one-pole coefficient per frame
+    float gain;
+    uint64_t frame;
+    float* delay;       // lookahead * channels samples
+    uint32_t delayPos;
+    float* dequeValue;  // window entries, increasing from head to tail
+    uint64_t* dequeFrame;
+    uint32_t dequeHead;
+    uint32_t dequeCount;
+    float* box;         // window entries
+    uint32_t boxPos;
+    double boxSum;
+} DspLimiter;
+
+// Returns 0 on success. Release with dsp_limiter_free.
+int dsp_limiter_init(DspLimiter* lim, uint32_t sampleRate, uint32_t channels, float lookaheadMs, float releaseMs, float ceiling);
+void dsp_limiter_free(DspLimiter* lim);
+// Clear the delay line and gain history, as if no audio had passed.
+void dsp_limiter_reset(DspLimiter* lim);
+void dsp_limiter_set_ceiling(DspLimiter* lim, float ceiling);
+// Limit frames in place. Returns the lowest gain applied in this block (1 if untouched).
+float dsp_limiter_process_f32(DspLimiter* lim, float* samples, size_t frames);
+
+// ITU-R BS.1770-4 loudness of interleaved audio: per-channel K-weighting, 100 ms
+// sub-blocks, 400 ms momentary and 3 s short-term windows, and integrated loudness over
+// 400 ms gating blocks with the -70 LUFS absolute and -10 LU relative gates. The gated
+// blocks are kept as a 0.1 LU histogram, so memory stays fixed however long it runs.
+#define DSP_LOUDNESS_MAX_CHANNELS 8
+#define DSP_LOUDNESS_HISTOGRAM_BINS 1000 // -70 to +30 LUFS
+#define DSP_LOUDNESS_SHORT_TERM_BLOCKS 30
+#define DSP_LOUDNESS_FLOOR -120.0        // reported for silence or no data
+
+typedef struct DspLoudness {
+    uint32_t channels;
+    double weights[DSP_LOUDNESS_MAX_CHANNELS];
+    double k[2][5];                            // shelf and highpass: b0 b1 b2 a1 a2
+    double z[2][2][DSP_LOUDNESS_MAX_CHANNELS]; // transposed direct form II state
+    uint32_t subBlockFrames;
+    uint32_t subBlockPos;
+    double subBlockSum;
+    double subBlocks[DSP_LOUDNESS_SHORT_TERM_BLOCKS]; // weighted energy sums, ring
+    uint64_t subBlockCount;
+    uint32_t histCount[DSP_LOUDNESS_HISTOGRAM_BINS];
+    double histEnergy[DSP_LOUDNESS_HISTOGRAM_BINS];
+} DspLoudness;
+
+// weights holds one BS.1770 channel weight per channel (1.0 front, 1.41 surround, 0 to
+// exclude such as LFE); NULL weights every channel 1.0. channels <= DSP_LOUDNESS_MAX_CHANNELS.
+void dsp_loudness_init(DspLoudness* m, uint32_t sampleRate, uint32_t channels, const float* weights);
+// Drop the measured history, keeping rate, channels and weights.
+void dsp_loudness_reset(DspLoudness* m);
+void dsp_loudness_add_f32(DspLoudness* m, const float* samples, size_t frames);
+// Loudness in LUFS; DSP_LOUDNESS_FLOOR until there is signal. Momentary and short-term
+// use whatever is available until their window has filled.
+double dsp_loudness_momentary(const DspLoudness* m);
+double dsp_loudness_short_term(const DspLoudness* m);
+double dsp_loudness_integrated(const DspLoudness* m);
+
+#define DSP_FNV1A64_INIT 0xcbf29ce484222325ull
+// Fold bytes into a 64-bit FNV-1a hash; used to compare rendered output bit for bit.
+uint64_t dsp_fnv1a64(uint64_t hash, const void* data, size_t bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
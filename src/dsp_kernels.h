@@ -0,0 +1,47 @@
+// Internal to the dsp library: one table of hot kernels per instruction set. Every table
+// is built from dsp_kernels_impl.h in its own translation unit with that unit's compiler
+// flags, and dsp.c binds the best one the running CPU supports.
+#ifndef ALGORYTHM_DSP_KERNELS_H
+#define ALGORYTHM_DSP_KERNELS_H
+
+#include "dsp.h"
+
+// Noise generator LCG, shared by the float kernels and the Q15 renderer in dsp.c.
+#define DSP_LCG_MUL 1664525u
+#define DSP_LCG_ADD 1013904223u
+#define DSP_LCG_SCALE (1.0f / 16777216.0f) // 2^-24, exact
+
+typedef struct DspKernels {
+    DspPath path;
+    void (*noise_render_planar)(DspNoise* st, float* const* planes, size_t frames, uint32_t channels, float amp);
+    void (*interleave)(const float* const* planes, const float* gains, float* out, size_t frames, uint32_t channels);
+    void (*channel_gains)(float* samples, size_t frames, uint32_t channels, const float* gains);
+    float (*gain_ramp)(float* samples, size_t frames, uint32_t channels, float gain, float step, float target);
+    void (*f32_to_s16)(const float* in, int16_t* out, size_t n);
+    void (*levels)(const float* samples, size_t n, DspLevels* out);
+    // acc += x * h over n complex bins in split form (convolution reverb).
+    void (*cmac)(float* accRe, float* accIm, const float* xr, const float* xi, const float* hr, const float* hi, uint32_t n);
+    // Dot product of taps floats, taps a multiple of 4 (resampler).
+    float (*dot)(const float* x, const float* h, uint32_t taps);
+} DspKernels;
+
+// The baseline instruction set of the target decides which tables exist; AVX2 is built
+// separately with -mavx2 and announced by the build through DSP_HAVE_AVX2_KERNELS.
+#if defined(__SSE2__) || defined(_M_X64)
+#define DSP_HAVE_SSE2_KERNELS 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define DSP_HAVE_NEON_KERNELS 1
+#endif
+
+extern const DspKernels dsp_kernels_scalar;
+#if defined(DSP_HAVE_SSE2_KERNELS)
+extern const DspKernels dsp_kernels_sse2;
+#endif
+#if defined(DSP_HAVE_AVX2_KERNELS)
+extern const DspKernels dsp_kernels_avx2;
+#endif
+#if defined(DSP_HAVE_NEON_KERNELS)
+extern const DspKernels dsp_kernels_neon;
+#endif
+
+#endif
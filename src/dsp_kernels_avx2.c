@@ -0,0 +1,9 @@
+// AVX2 kernels. The build compiles only this unit with -mavx2 (/arch:AVX2) and defines
+// DSP_HAVE_AVX2_KERNELS; dsp_init binds it when the CPU and OS support AVX2.
+#include "dsp_kernels.h"
+
+#if defined(__AVX2__)
+#define DSP_KERNELS_TABLE dsp_kernels_avx2
+#define DSP_KERNELS_PATH DSP_PATH_AVX2
+#include "dsp_kernels_impl.h"
+#endif
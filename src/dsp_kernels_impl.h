@@ -0,0 +1,290 @@
+// Internal to the dsp library: the dispatched kernels, written once against the vector
+// helpers in dsp_simd.h. A kernel unit defines DSP_KERNELS_TABLE and DSP_KERNELS_PATH
+// and includes this to emit its table. Sections under DSP_SIMD_AVX2 widen kernels only
+// where rendered output stays bit-identical to the other paths.
+#include <math.h>
+
+#include "dsp_kernels.h"
+#include "dsp_simd.h"
+
+// Move up to four buffered frames (rows of four channels) into the planes of the
+// n channels starting at c.
+static inline void noise_flush_rows(V4f rows[4], size_t count, float* const* planes, uint32_t c, uint32_t n, size_t f0) {
+    if (count == 4 && n == 4) {
+        v4f_transpose(rows);
+        for (uint32_t i = 0; i < 4; ++i) v4f_store(planes[c + i] + f0, rows[i]);
+        return;
+    }
+    float tmp[4][4];
+    for (size_t r = 0; r < count; ++r) v4f_store(tmp[r], rows[r]);
+    for (uint32_t i = 0; i < n; ++i) {
+        for (size_t r = 0; r < count; ++r) planes[c + i][f0 + r] = tmp[r][i];
+    }
+}
+
+// Generate frames for channels [c, c + n), n <= 4, one lane per channel. The group's
+// generator and filter state stay in registers for the whole block. Lanes past n
+// advance unused state, which leaves the used lanes unaffected.
+static void noise_group_planar(DspNoise* st, uint32_t c, uint32_t n, float* const* planes, size_t frames, float amp) {
+    V4u s = v4u_load(&st->lanes[c]);
+    V4f b[7];
+    for (int k = 0; k < 7; ++k) b[k] = v4f_load(&st->pink[k][c]);
+    V4f brown = v4f_load(&st->brown[c]);
+    const V4f scale = v4f_set1(DSP_LCG_SCALE), two = v4f_set1(2.0f), one = v4f_set1(1.0f), gain = v4f_set1(amp);
+    V4f rows[4];
+    size_t pending = 0;
+    for (size_t f = 0; f < frames; ++f) {
+        // The high 24 bits of each LCG step give a uniform sample in [-1, 1); the low
+        // bits of a power-of-two LCG cycle too quickly.
+        s = v4u_lcg_step(s);
+        V4f w = v4f_sub(v4f_mul(v4f_mul(v4u_high24_to_f32(s), scale), two), one);
+        V4f y;
+        switch (st->color) {
+        case DSP_NOISE_PINK: {
+            // Paul Kellet's refined pink filter, roughly unity gain after the 0.11 scale.
+            b[0] = v4f_add(v4f_mul(v4f_set1(0.99886f), b[0]), v4f_mul(w, v4f_set1(0.0555179f)));
+            b[1] = v4f_add(v4f_mul(v4f_set1(0.99332f), b[1]), v4f_mul(w, v4f_set1(0.0750759f)));
+            b[2] = v4f_add(v4f_mul(v4f_set1(0.96900f), b[2]), v4f_mul(w, v4f_set1(0.1538520f)));
+            b[3] = v4f_add(v4f_mul(v4f_set1(0.86650f), b[3]), v4f_mul(w, v4f_set1(0.3104856f)));
+            b[4] = v4f_add(v4f_mul(v4f_set1(0.55000f), b[4]), v4f_mul(w, v4f_set1(0.5329522f)));
+            b[5] = v4f_sub(v4f_mul(v4f_set1(-0.7616f), b[5]), v4f_mul(w, v4f_set1(0.0168980f)));
+            V4f p = v4f_add(v4f_add(v4f_add(v4f_add(v4f_add(v4f_add(b[0], b[1]), b[2]), b[3]), b[4]), b[5]), b[6]);
+            p = v4f_add(p, v4f_mul(w, v4f_set1(0.5362f)));
+            b[6] = v4f_mul(w, v4f_set1(0.115926f));
+            y = v4f_mul(v4f_mul(p, v4f_set1(0.11f)), gain);
+            break;
+        }
+        case DSP_NOISE_BROWN:
+            brown = v4f_div(v4f_add(brown, v4f_mul(v4f_set1(0.02f), w)), v4f_set1(1.02f));
+            y = v4f_mul(v4f_mul(brown, v4f_set1(3.5f)), gain);
+            break;
+        default:
+            y = v4f_mul(w, gain);
+            break;
+        }
+        rows[pending++] = y;
+        if (pending == 4) {
+            noise_flush_rows(rows, 4, planes, c, n, f - 3);
+            pending = 0;
+        }
+    }
+    if (pending) noise_flush_rows(rows, pending, planes, c, n, frames - pending);
+    v4u_store(&st->lanes[c], s);
+    for (int k = 0; k < 7; ++k) v4f_store(&st->pink[k][c], b[k]);
+    v4f_store(&st->brown[c], brown);
+}
+
+static void noise_render_planar_f32(DspNoise* st, float* const* planes, size_t frames, uint32_t channels, float amp) {
+    for (uint32_t c = 0; c < channels; c += 4) {
+        noise_group_planar(st, c, channels - c < 4 ? channels - c : 4, planes, frames, amp);
+    }
+}
+
+static void interleave_f32(const float* const* planes, const float* gains, float* out, size_t frames, uint32_t channels) {
+    uint32_t c = 0;
+    for (; c + 4 <= channels; c += 4) {
+        const V4f g = gains ? v4f_load(gains + c) : v4f_set1(1.0f);
+        size_t f = 0;
+        for (; f + 4 <= frames; f += 4) {
+            V4f r[4];
+            for (int i = 0; i < 4; ++i) r[i] = v4f_load(planes[c + i] + f);
+            v4f_transpose(r);
+            for (int i = 0; i < 4; ++i) v4f_store(out + (f + i) * channels + c, v4f_mul(r[i], g));
+        }
+        for (; f < frames; ++f) {
+            for (uint32_t i = 0; i < 4; ++i) out[f * channels + c + i] = planes[c + i][f] * (gains ? gains[c + i] : 1.0f);
+        }
+    }
+    for (; c < channels; ++c) {
+        const float g = gains ? gains[c] : 1.0f;
+        for (size_t f = 0; f < frames; ++f) out[f * channels + c] = planes[c][f] * g;
+    }
+}
+
+static void channel_gains_f32(float* samples, size_t frames, uint32_t channels, const float* gains) {
+    for (size_t f = 0; f < frames; ++f) {
+        float* frame = samples + f * channels;
+        uint32_t c = 0;
+        for (; c + 4 <= channels; c += 4) v4f_store(frame + c, v4f_mul(v4f_load(frame + c), v4f_load(gains + c)));
+        for (; c < channels; ++c) frame[c] *= gains[c];
+    }
+}
+
+static void f32_to_s16(const float* in, int16_t* out, size_t n) {
+    size_t i = 0;
+#if defined(DSP_SIMD_AVX2)
+    const __m256 scale8 = _mm256_set1_ps(32767.0f);
+    for (; i + 16 <= n; i += 16) {
+        __m256i a = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(in + i), scale8));
+        __m256i b = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(in + i + 8), scale8));
+        // packs works within 128-bit halves; put the four quarters back in order.
+        __m256i p = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256((__m256i*)(out + i), p);
+    }
+#endif
+#if defined(DSP_SIMD_SSE2)
+    const __m128 scale = _mm_set1_ps(32767.0f);
+    for (; i + 8 <= n; i += 8) {
+        // cvtps rounds to nearest; packs saturates to the s16 range.
+        __m128i a = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(in + i), scale));
+        __m128i b = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(in + i + 4), scale));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(a, b));
+    }
+#elif defined(DSP_SIMD_NEON)
+    const float32x4_t scale = vdupq_n_f32(32767.0f);
+    for (; i + 8 <= n; i += 8) {
+        int32x4_t a = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(in + i), scale));
+        int32x4_t b = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(in + i + 4), scale));
+        vst1q_s16(out + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+    }
+#endif
+    for (; i < n; ++i) {
+        float v = in[i] * 32767.0f;
+        if (v > 32767.0f) v = 32767.0f;
+        if (v < -32768.0f) v = -32768.0f;
+        out[i] = (int16_t)lrintf(v);
+    }
+}
+
+static float gain_ramp_f32(float* samples, size_t frames, uint32_t channels, float gain, float step, float target) {
+    for (size_t f = 0; f < frames; ++f) {
+        if (step != 0.0f) {
+            gain += step;
+            if ((step > 0.0f && gain >= target) || (step < 0.0f && gain <= target)) {
+                gain = target;
+                step = 0.0f;
+            }
+        }
+        float* frame = samples + f * channels;
+        const V4f g = v4f_set1(gain);
+        uint32_t c = 0;
+        for (; c + 4 <= channels; c += 4) v4f_store(frame + c, v4f_mul(v4f_load(frame + c), g));
+        for (; c < channels; ++c) frame[c] *= gain;
+    }
+    return gain;
+}
+
+static void levels_f32(const float* samples, size_t n, DspLevels* out) {
+    size_t i = 0;
+    float sum = 0.0f;
+    float peak = 0.0f;
+    uint32_t clips = 0;
+#if defined(DSP_SIMD_AVX2)
+    const __m256 absMask8 = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    const __m256 one8 = _mm256_set1_ps(1.0f);
+    __m256 vsum8 = _mm256_setzero_ps();
+    __m256 vpeak8 = _mm256_setzero_ps();
+    __m256i vclips8 = _mm256_setzero_si256();
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_loadu_ps(samples + i);
+        __m256 a = _mm256_and_ps(x, absMask8);
+        vsum8 = _mm256_add_ps(vsum8, _mm256_mul_ps(x, x));
+        vpeak8 = _mm256_max_ps(vpeak8, a);
+        vclips8 = _mm256_sub_epi32(vclips8, _mm256_castps_si256(_mm256_cmp_ps(a, one8, _CMP_GE_OQ)));
+    }
+#endif
+#if defined(DSP_SIMD_SSE2)
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    const __m128 one = _mm_set1_ps(1.0f);
+#if defined(DSP_SIMD_AVX2)
+    // Fold the 8-lane partials into the 4-lane loop that handles the tail.
+    __m128 vsum = _mm_add_ps(_mm256_castps256_ps128(vsum8), _mm256_extractf128_ps(vsum8, 1));
+    __m128 vpeak = _mm_max_ps(_mm256_castps256_ps128(vpeak8), _mm256_extractf128_ps(vpeak8, 1));
+    __m128i vclips = _mm_add_epi32(_mm256_castsi256_si128(vclips8), _mm256_extracti128_si256(vclips8, 1));
+#else
+    __m128 vsum = _mm_setzero_ps();
+    __m128 vpeak = _mm_setzero_ps();
+    __m128i vclips = _mm_setzero_si128();
+#endif
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_loadu_ps(samples + i);
+        __m128 a = _mm_and_ps(x, absMask);
+        vsum = _mm_add_ps(vsum, _mm_mul_ps(x, x));
+        vpeak = _mm_max_ps(vpeak, a);
+        // Comparison masks are all ones (-1) per matching lane.
+        vclips = _mm_sub_epi32(vclips, _mm_castps_si128(_mm_cmpge_ps(a, one)));
+    }
+    float lanes[4];
+    uint32_t counts[4];
+    _mm_storeu_ps(lanes, vsum);
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    _mm_storeu_ps(lanes, vpeak);
+    peak = fmaxf(fmaxf(lanes[0], lanes[1]), fmaxf(lanes[2], lanes[3]));
+    _mm_storeu_si128((__m128i*)counts, vclips);
+    clips = counts[0] + counts[1] + counts[2] + counts[3];
+#elif defined(DSP_SIMD_NEON)
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    float32x4_t vsum = vdupq_n_f32(0.0f);
+    float32x4_t vpeak = vdupq_n_f32(0.0f);
+    uint32x4_t vclips = vdupq_n_u32(0);
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t x = vld1q_f32(samples + i);
+        float32x4_t a = vabsq_f32(x);
+        vsum = vmlaq_f32(vsum, x, x);
+        vpeak = vmaxq_f32(vpeak, a);
+        vclips = vsubq_u32(vclips, vcgeq_f32(a, one));
+    }
+    float lanes[4];
+    uint32_t counts[4];
+    vst1q_f32(lanes, vsum);
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    vst1q_f32(lanes, vpeak);
+    peak = fmaxf(fmaxf(lanes[0], lanes[1]), fmaxf(lanes[2], lanes[3]));
+    vst1q_u32(counts, vclips);
+    clips = counts[0] + counts[1] + counts[2] + counts[3];
+#endif
+    for (; i < n; ++i) {
+        float x = samples[i];
+        float a = fabsf(x);
+        sum += x * x;
+        if (a > peak) peak = a;
+        if (a >= 1.0f) clips++;
+    }
+    out->sumSquares = sum;
+    out->peak = peak;
+    out->clipCount = clips;
+}
+
+static void conv_cmac(float* accRe, float* accIm, const float* xr, const float* xi, const float* hr, const float* hi, uint32_t n) {
+    uint32_t k = 0;
+#if defined(DSP_SIMD_AVX2)
+    for (; k + 8 <= n; k += 8) {
+        __m256 a = _mm256_loadu_ps(xr + k), b = _mm256_loadu_ps(xi + k);
+        __m256 c = _mm256_loadu_ps(hr + k), d = _mm256_loadu_ps(hi + k);
+        _mm256_storeu_ps(accRe + k, _mm256_add_ps(_mm256_loadu_ps(accRe + k), _mm256_sub_ps(_mm256_mul_ps(a, c), _mm256_mul_ps(b, d))));
+        _mm256_storeu_ps(accIm + k, _mm256_add_ps(_mm256_loadu_ps(accIm + k), _mm256_add_ps(_mm256_mul_ps(a, d), _mm256_mul_ps(b, c))));
+    }
+#endif
+    for (; k + 4 <= n; k += 4) {
+        V4f a = v4f_load(xr + k), b = v4f_load(xi + k);
+        V4f c = v4f_load(hr + k), d = v4f_load(hi + k);
+        v4f_store(accRe + k, v4f_add(v4f_load(accRe + k), v4f_sub(v4f_mul(a, c), v4f_mul(b, d))));
+        v4f_store(accIm + k, v4f_add(v4f_load(accIm + k), v4f_add(v4f_mul(a, d), v4f_mul(b, c))));
+    }
+    for (; k < n; ++k) {
+        accRe[k] += xr[k] * hr[k] - xi[k] * hi[k];
+        accIm[k] += xr[k] * hi[k] + xi[k] * hr[k];
+    }
+}
+
+// Four partial sums whatever the vector width, so resampled renders hash the same on
+// every path.
+static float resampler_dot(const float* x, const float* h, uint32_t taps) {
+    V4f acc = v4f_set1(0.0f);
+    for (uint32_t k = 0; k < taps; k += 4) acc = v4f_add(acc, v4f_mul(v4f_load(x + k), v4f_load(h + k)));
+    float lanes[4];
+    v4f_store(lanes, acc);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+const DspKernels DSP_KERNELS_TABLE = {
+    DSP_KERNELS_PATH,
+    noise_render_planar_f32,
+    interleave_f32,
+    channel_gains_f32,
+    gain_ramp_f32,
+    f32_to_s16,
+    levels_f32,
+    conv_cmac,
+    resampler_dot,
+};
@@ -0,0 +1,8 @@
+// AArch64 Advanced SIMD kernels.
+#include "dsp_kernels.h"
+
+#if defined(DSP_HAVE_NEON_KERNELS)
+#define DSP_KERNELS_TABLE dsp_kernels_neon
+#define DSP_KERNELS_PATH DSP_PATH_NEON
+#include "dsp_kernels_impl.h"
+#endif
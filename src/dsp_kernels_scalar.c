@@ -0,0 +1,5 @@
+// Portable kernels: the reference path, and the only one on targets without SSE2/NEON.
+#define DSP_SCALAR_KERNELS 1
+#define DSP_KERNELS_TABLE dsp_kernels_scalar
+#define DSP_KERNELS_PATH DSP_PATH_SCALAR
+#include "dsp_kernels_impl.h"
@@ -0,0 +1,8 @@
+// SSE2 kernels, the x86-64 baseline.
+#include "dsp_kernels.h"
+
+#if defined(DSP_HAVE_SSE2_KERNELS)
+#define DSP_KERNELS_TABLE dsp_kernels_sse2
+#define DSP_KERNELS_PATH DSP_PATH_SSE2
+#include "dsp_kernels_impl.h"
+#endif
@@ -0,0 +1,191 @@
+// Compile-time noise pipelines: a generator followed by per-sample stages, composed with
+// operator| and fused into one loop per channel and block, e.g.
+//
+//     auto p = dsp::Pink{} | dsp::Biquad{dsp::BiquadCoeffs::lowpass(48000.0f, 800.0f, 0.7071f)} | dsp::Gain{0.5f};
+//     p.render(out, frames, channels, amp);
+//
+// The generator fills a small planar chunk with the SIMD kernel from dsp.c; every stage
+// then runs in a single pass over that chunk with its per-channel state held in locals,
+// and the pass writes the interleaved output. Each distinct chain is its own type, so
+// callers pick from a fixed set of instantiations rather than building chains at runtime.
+#ifndef ALGORYTHM_DSP_PIPELINE_HPP
+#define ALGORYTHM_DSP_PIPELINE_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "dsp.h"
+
+namespace dsp {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// Noise source. White, Pink and Brown only pick the initial color.
+struct Noise {
+    DspNoise state;
+
+    explicit Noise(DspNoiseColor color = DSP_NOISE_WHITE, uint32_t seed = 1) { dsp_noise_init(&state, color, seed); }
+    void reset(DspNoiseColor color, uint32_t seed) { dsp_noise_init(&state, color, seed); }
+};
+
+struct White : Noise { explicit White(uint32_t seed = 1) : Noise(DSP_NOISE_WHITE, seed) {} };
+struct Pink : Noise { explicit Pink(uint32_t seed = 1) : Noise(DSP_NOISE_PINK, seed) {} };
+struct Brown : Noise { explicit Brown(uint32_t seed = 1) : Noise(DSP_NOISE_BROWN, seed) {} };
+
+// Stages derive from Stage and provide lane(channel), returning a small callable that
+// holds that channel's state by value, and commit(channel, lane) to store it back.
+struct Stage {};
+
+template <class T>
+constexpr bool is_stage_v = std::is_base_of<Stage, T>::value;
+
+struct Gain : Stage {
+    float gain = 1.0f;
+
+    Gain() = default;
+    explicit Gain(float g) : gain(g) {}
+
+    struct Lane {
+        float gain;
+        float operator()(float x) const { return x * gain; }
+    };
+    Lane lane(uint32_t) const { return Lane{gain}; }
+    void commit(uint32_t, const Lane&) {}
+};
+
+// One linear gain per channel; 0 mutes.
+struct ChannelGains : Stage {
+    float gains[DSP_MAX_CHANNELS];
+
+    ChannelGains() { set_unity(); }
+    void set_unity() {
+        for (float& g : gains) g = 1.0f;
+    }
+
+    struct Lane {
+        float gain;
+        float operator()(float x) const { return x * gain; }
+    };
+    Lane lane(uint32_t channel) const { return Lane{gains[channel]}; }
+    void commit(uint32_t, const Lane&) {}
+};
+
+// Normalized second-order section (a0 = 1), designed with the RBJ cookbook formulas.
+struct BiquadCoeffs {
+    float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f, a1 = 0.0f, a2 = 0.0f;
+
+    static BiquadCoeffs lowpass(float rate, float hz, float q) {
+        double w = 2.0 * kPi * hz / rate, c = std::cos(w), alpha = std::sin(w) / (2.0 * q);
+        return normalize((1.0 - c) / 2.0, 1.0 - c, (1.0 - c) / 2.0, 1.0 + alpha, -2.0 * c, 1.0 - alpha);
+    }
+    static BiquadCoeffs highpass(float rate, float hz, float q) {
+        double w = 2.0 * kPi * hz / rate, c = std::cos(w), alpha = std::sin(w) / (2.0 * q);
+        return normalize((1.0 + c) / 2.0, -(1.0 + c), (1.0 + c) / 2.0, 1.0 + alpha, -2.0 * c, 1.0 - alpha);
+    }
+    // Constant 0 dB peak gain at hz.
+    static BiquadCoeffs bandpass(float rate, float hz, float q) {
+        double w = 2.0 * kPi * hz / rate, c = std::cos(w), alpha = std::sin(w) / (2.0 * q);
+        return normalize(alpha, 0.0, -alpha, 1.0 + alpha, -2.0 * c, 1.0 - alpha);
+    }
+
+private:
+    static BiquadCoeffs normalize(double b0, double b1, double b2, double a0, double a1, double a2) {
+        BiquadCoeffs k;
+        k.b0 = (float)(b0 / a0);
+        k.b1 = (float)(b1 / a0);
+        k.b2 = (float)(b2 / a0);
+        k.a1 = (float)(a1 / a0);
+        k.a2 = (float)(a2 / a0);
+        return k;
+    }
+};
+
+// Transposed direct form II biquad with independent state per channel.
+struct Biquad : Stage {
+    BiquadCoeffs k;
+    float z1[DSP_MAX_CHANNELS] = {};
+    float z2[DSP_MAX_CHANNELS] = {};
+
+    Biquad() = default;
+    explicit Biquad(const BiquadCoeffs& coeffs) : k(coeffs) {}
+    void set(const BiquadCoeffs& coeffs) {
+        k = coeffs;
+        reset();
+    }
+    void reset() {
+        for (size_t c = 0; c < DSP_MAX_CHANNELS; ++c) z1[c] = z2[c] = 0.0f;
+    }
+
+    struct Lane {
+        BiquadCoeffs k;
+        float z1, z2;
+        float operator()(float x) {
+            float y = k.b0 * x + z1;
+            z1 = k.b1 * x - k.a1 * y + z2;
+            z2 = k.b2 * x - k.a2 * y;
+            return y;
+        }
+    };
+    Lane lane(uint32_t channel) const { return Lane{k, z1[channel], z2[channel]}; }
+    void commit(uint32_t channel, const Lane& l) {
+        z1[channel] = l.z1;
+        z2[channel] = l.z2;
+    }
+};
+
+template <class... Stages>
+struct Pipeline {
+    static constexpr size_t kChunkFrames = 64;
+
+    Noise source;
+    std::tuple<Stages...> stages;
+
+    template <size_t I>
+    auto& stage() { return std::get<I>(stages); }
+
+    // Render frames of interleaved output; channels <= DSP_MAX_CHANNELS.
+    void render(float* out, size_t frames, uint32_t channels, float amp) {
+        alignas(16) float scratch[kChunkFrames * DSP_MAX_CHANNELS];
+        float* planes[DSP_MAX_CHANNELS];
+        while (frames > 0) {
+            size_t n = frames < kChunkFrames ? frames : kChunkFrames;
+            for (uint32_t c = 0; c < channels; ++c) planes[c] = scratch + c * kChunkFrames;
+            dsp_noise_render_planar_f32(&source.state, planes, n, channels, amp);
+            for (uint32_t c = 0; c < channels; ++c) {
+                run_channel(planes[c], out + c, n, channels, c, std::index_sequence_for<Stages...>{});
+            }
+            out += n * channels;
+            frames -= n;
+        }
+    }
+
+private:
+    template <size_t... I>
+    void run_channel(const float* in, float* out, size_t frames, uint32_t stride, uint32_t channel, std::index_sequence<I...>) {
+        auto lanes = std::make_tuple(std::get<I>(stages).lane(channel)...);
+        for (size_t f = 0; f < frames; ++f) {
+            float x = in[f];
+            ((x = std::get<I>(lanes)(x)), ...);
+            out[f * stride] = x;
+        }
+        (std::get<I>(stages).commit(channel, std::get<I>(lanes)), ...);
+    }
+};
+
+template <class S, class = std::enable_if_t<is_stage_v<S>>>
+Pipeline<S> operator|(Noise source, S stage) {
+    return Pipeline<S>{std::move(source), std::tuple<S>(std::move(stage))};
+}
+
+template <class... Ss, class S, class = std::enable_if_t<is_stage_v<S>>>
+Pipeline<Ss..., S> operator|(Pipeline<Ss...> p, S stage) {
+    return Pipeline<Ss..., S>{std::move(p.source), std::tuple_cat(std::move(p.stages), std::tuple<S>(std::move(stage)))};
+}
+
+} // namespace dsp
+
+#endif
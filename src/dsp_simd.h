@@ -0,0 +1,100 @@
+// Internal to the dsp library: vector helpers shared by the kernel translation units.
+// Each unit is built with its own instruction set flags; defining DSP_SCALAR_KERNELS
+// before including this selects the portable fallback whatever the compiler targets.
+#ifndef ALGORYTHM_DSP_SIMD_H
+#define ALGORYTHM_DSP_SIMD_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "dsp_kernels.h"
+
+#if defined(DSP_SCALAR_KERNELS)
+// portable fallback below
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define DSP_SIMD_SSE2 1
+#define DSP_SIMD_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define DSP_SIMD_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define DSP_SIMD_NEON 1
+#endif
+
+// Four-lane vector helpers so the kernels are written once. The scalar fallback
+// performs the same IEEE operations in the same order, so every path is bit-identical.
+#if defined(DSP_SIMD_SSE2)
+typedef __m128 V4f;
+typedef __m128i V4u;
+static inline V4f v4f_load(const float* p) { return _mm_loadu_ps(p); }
+static inline void v4f_store(float* p, V4f a) { _mm_storeu_ps(p, a); }
+static inline V4f v4f_set1(float x) { return _mm_set1_ps(x); }
+static inline V4f v4f_add(V4f a, V4f b) { return _mm_add_ps(a, b); }
+static inline V4f v4f_sub(V4f a, V4f b) { return _mm_sub_ps(a, b); }
+static inline V4f v4f_mul(V4f a, V4f b) { return _mm_mul_ps(a, b); }
+static inline V4f v4f_div(V4f a, V4f b) { return _mm_div_ps(a, b); }
+static inline V4u v4u_load(const uint32_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+static inline void v4u_store(uint32_t* p, V4u a) { _mm_storeu_si128((__m128i*)p, a); }
+#if defined(DSP_SIMD_AVX2)
+// SSE4.1 low multiply, available alongside AVX2.
+static inline V4u v4u_lcg_step(V4u s) {
+    return _mm_add_epi32(_mm_mullo_epi32(s, _mm_set1_epi32((int)DSP_LCG_MUL)), _mm_set1_epi32((int)DSP_LCG_ADD));
+}
+#else
+// SSE2 has no 32-bit low multiply; combine the even and odd 32x32->64 products.
+static inline V4u v4u_lcg_step(V4u s) {
+    const __m128i mul = _mm_set1_epi32((int)DSP_LCG_MUL);
+    __m128i even = _mm_mul_epu32(s, mul);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(s, 32), _mm_srli_epi64(mul, 32));
+    __m128i lo = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    return _mm_add_epi32(lo, _mm_set1_epi32((int)DSP_LCG_ADD));
+}
+#endif
+static inline V4f v4u_high24_to_f32(V4u s) { return _mm_cvtepi32_ps(_mm_srli_epi32(s, 8)); }
+static inline void v4f_transpose(V4f r[4]) { _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]); }
+#elif defined(DSP_SIMD_NEON)
+typedef float32x4_t V4f;
+typedef uint32x4_t V4u;
+static inline V4f v4f_load(const float* p) { return vld1q_f32(p); }
+static inline void v4f_store(float* p, V4f a) { vst1q_f32(p, a); }
+static inline V4f v4f_set1(float x) { return vdupq_n_f32(x); }
+static inline V4f v4f_add(V4f a, V4f b) { return vaddq_f32(a, b); }
+static inline V4f v4f_sub(V4f a, V4f b) { return vsubq_f32(a, b); }
+static inline V4f v4f_mul(V4f a, V4f b) { return vmulq_f32(a, b); }
+static inline V4f v4f_div(V4f a, V4f b) { return vdivq_f32(a, b); }
+static inline V4u v4u_load(const uint32_t* p) { return vld1q_u32(p); }
+static inline void v4u_store(uint32_t* p, V4u a) { vst1q_u32(p, a); }
+static inline V4u v4u_lcg_step(V4u s) { return vaddq_u32(vmulq_u32(s, vdupq_n_u32(DSP_LCG_MUL)), vdupq_n_u32(DSP_LCG_ADD)); }
+static inline V4f v4u_high24_to_f32(V4u s) { return vcvtq_f32_u32(vshrq_n_u32(s, 8)); }
+static inline void v4f_transpose(V4f r[4]) {
+    float32x4x2_t t01 = vtrnq_f32(r[0], r[1]);
+    float32x4x2_t t23 = vtrnq_f32(r[2], r[3]);
+    r[0] = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+    r[1] = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+    r[2] = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+    r[3] = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+}
+#else
+typedef struct { float v[4]; } V4f;
+typedef struct { uint32_t v[4]; } V4u;
+static inline V4f v4f_load(const float* p) { V4f r; memcpy(r.v, p, sizeof(r.v)); return r; }
+static inline void v4f_store(float* p, V4f a) { memcpy(p, a.v, sizeof(a.v)); }
+static inline V4f v4f_set1(float x) { V4f r = {{x, x, x, x}}; return r; }
+static inline V4f v4f_add(V4f a, V4f b) { for (int i = 0; i < 4; ++i) a.v[i] = a.v[i] + b.v[i]; return a; }
+static inline V4f v4f_sub(V4f a, V4f b) { for (int i = 0; i < 4; ++i) a.v[i] = a.v[i] - b.v[i]; return a; }
+static inline V4f v4f_mul(V4f a, V4f b) { for (int i = 0; i < 4; ++i) a.v[i] = a.v[i] * b.v[i]; return a; }
+static inline V4f v4f_div(V4f a, V4f b) { for (int i = 0; i < 4; ++i) a.v[i] = a.v[i] / b.v[i]; return a; }
+static inline V4u v4u_load(const uint32_t* p) { V4u r; memcpy(r.v, p, sizeof(r.v)); return r; }
+static inline void v4u_store(uint32_t* p, V4u a) { memcpy(p, a.v, sizeof(a.v)); }
+static inline V4u v4u_lcg_step(V4u s) { for (int i = 0; i < 4; ++i) s.v[i] = s.v[i] * DSP_LCG_MUL + DSP_LCG_ADD; return s; }
+static inline V4f v4u_high24_to_f32(V4u s) { V4f r; for (int i = 0; i < 4; ++i) r.v[i] = (float)(s.v[i] >> 8); return r; }
+static inline void v4f_transpose(V4f r[4]) {
+    V4f t[4];
+    for (int i = 0; i < 4; ++i) for (int j = 0; j < 4; ++j) t[i].v[j] = r[j].v[i];
+    for (int i = 0; i < 4; ++i) r[i] = t[i];
+}
+#endif
+
+#endif
@@ -0,0 +1,546 @@
+// Unit checks for the dsp library; run through ctest. Each check prints what failed and
+// the process exits non-zero if any did.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dsp.h"
+
+#define DSP_TEST_PI 3.14159265358979323846
+
+static int g_failures = 0;
+
+#define CHECK(cond, ...)                                \
+    do {                                                \
+        if (!(cond)) {                                  \
+            fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);               \
+            fprintf(stderr, "\n");                      \
+            g_failures++;                               \
+        }                                               \
+    } while (0)
+
+// A peak that decays monotonically for far longer than the lookahead window keeps the
+// sliding minimum deque full. The limiter must keep the output under the ceiling through
+// its gain alone, with the gain moving smoothly rather than falling back to the clamp.
+static void test_limiter_decaying_peak(void) {
+    const uint32_t rate = 48000, channels = 2;
+    const float ceiling = 0.5f;
+    DspLimiter lim;
+    CHECK(dsp_limiter_init(&lim, rate, channels, 2.0f, 60.0f, ceiling) == 0, "limiter init failed");
+    const uint32_t lookahead = lim.lookahead;
+    const size_t frames = (size_t)rate; // ~500 windows
+    float* in = (float*)malloc(frames * channels * sizeof(float));
+    float* out = (float*)malloc(frames * channels * sizeof(float));
+    for (size_t f = 0; f < frames; ++f) {
+        // Peak decays strictly from 4x the ceiling towards it, so every frame needs a
+        // little less reduction than the last and no deque entry is ever dominated.
+        float env = 0.5f + 1.5f * expf(-(float)f / (float)(rate / 4));
+        float x = (f & 1) ? -env : env;
+        in[f * channels] = out[f * channels] = x;
+        in[f * channels + 1] = out[f * channels + 1] = -0.5f * x;
+    }
+    for (size_t done = 0; done < frames; done += 480) {
+        dsp_limiter_process_f32(&lim, out + done * channels, 480);
+        CHECK(lim.dequeCount <= lookahead + 1, "deque holds %u entries for a window of %u", lim.dequeCount, lookahead + 1);
+    }
+
+    size_t clamped = 0;
+    float prevGain = -1.0f, maxStep = 0.0f;
+    for (size_t f = lookahead; f < frames; ++f) {
+        float x = in[(f - lookahead) * channels];
+        float y = out[f * channels];
+        CHECK(fabsf(y) <= ceiling, "frame %zu: |%f| above ceiling", f, y);
+        if (fabsf(y) >= ceiling) clamped++;
+        float gain = y / x;
+        if (prevGain >= 0.0f && fabsf(gain - prevGain) > maxStep) maxStep = fabsf(gain - prevGain);
+        prevGain = gain;
+    }
+    // The gain only ever touches the ceiling on rounding, and never jumps.
+    CHECK(clamped < frames / 1000, "%zu frames hit the hard clamp", clamped);
+    CHECK(maxStep < 0.01f, "gain jumped by %f between frames", maxStep);
+    free(in);
+    free(out);
+    dsp_limiter_free(&lim);
+}
+
+// The Q30 ramp follows the float ramp on the same samples to within one step, reaches and
+// holds its target, and saturates instead of wrapping.
+static void test_gain_ramp_s16(void) {
+    enum { kFrames = 1000, kChannels = 2, kRamp = 480 };
+    int16_t s16[kFrames * kChannels];
+    float f32[kFrames * kChannels];
+    for (int i = 0; i < kFrames * kChannels; ++i) {
+        s16[i] = (int16_t)((i * 7919) % 65535 - 32767);
+        f32[i] = (float)s16[i];
+    }
+    int32_t gain = dsp_gain_ramp_s16(s16, kFrames, kChannels, 0, DSP_Q30_ONE / kRamp, DSP_Q30_ONE);
+    float gainF = dsp_gain_ramp_f32(f32, kFrames, kChannels, 0.0f, 1.0f / kRamp, 1.0f);
+    CHECK(gain == DSP_Q30_ONE, "fade-in ended at %d, not unity", (int)gain);
+    CHECK(gainF == 1.0f, "float fade-in ended at %f", gainF);
+    int maxDiff = 0;
+    for (int i = 0; i < kFrames * kChannels; ++i) {
+        int diff = abs((int)s16[i] - (int)lrintf(f32[i]));
+        if (diff > maxDiff) maxDiff = diff;
+    }
+    CHECK(maxDiff <= 1, "s16 ramp differs from float by %d steps", maxDiff);
+    for (int i = (kRamp + 1) * kChannels; i < kFrames * kChannels; ++i) {
+        CHECK(s16[i] == (int16_t)((i * 7919) % 65535 - 32767), "sample %d changed after the ramp held unity", i);
+    }
+
+    gain = dsp_gain_ramp_s16(s16, kFrames, kChannels, DSP_Q30_ONE, -(DSP_Q30_ONE / kRamp + 1), 0);
+    CHECK(gain == 0, "fade-out ended at %d, not silence", (int)gain);
+    for (int i = kRamp * kChannels; i < kFrames * kChannels; ++i) {
+        CHECK(s16[i] == 0, "sample %d is %d after the fade-out", i, s16[i]);
+    }
+
+    int16_t loud[2] = { 30000, -30000 };
+    dsp_gain_ramp_s16(loud, 1, 2, DSP_Q30_ONE + DSP_Q30_ONE / 2, 0, 0);
+    CHECK(loud[0] == 32767 && loud[1] == -32768, "1.5x gain gave %d, %d instead of saturating", loud[0], loud[1]);
+}
+
+// Fill frames of a sine on every channel, continuing from phase *frame.
+static void fill_sine(float* out, size_t frames, uint32_t channels, double hz, double rate, float amp, size_t* frame) {
+    for (size_t f = 0; f < frames; ++f, ++*frame) {
+        float x = amp * (float)sin(2.0 * DSP_TEST_PI * hz * (double)*frame / rate);
+        for (uint32_t c = 0; c < channels; ++c) out[f * channels + c] = x;
+    }
+}
+
+// A full-scale 997 Hz sine on one channel reads -3.01 LUFS under BS.1770, so -20 dBFS
+// reads -23.01 LUFS at either rate the filters are redesigned for.
+static void test_loudness_sine_level(void) {
+    const uint32_t rates[2] = { 48000, 44100 };
+    for (int r = 0; r < 2; ++r) {
+        DspLoudness m;
+        dsp_loudness_init(&m, rates[r], 1, NULL);
+        float* buf = (float*)malloc((size_t)rates[r] * sizeof(float));
+        size_t frame = 0;
+        for (int s = 0; s < 5; ++s) {
+            fill_sine(buf, rates[r], 1, 997.0, rates[r], 0.1f, &frame);
+            dsp_loudness_add_f32(&m, buf, rates[r]);
+        }
+        double integrated = dsp_loudness_integrated(&m);
+        double momentary = dsp_loudness_momentary(&m);
+        double shortTerm = dsp_loudness_short_term(&m);
+        CHECK(fabs(integrated + 23.01) < 0.05, "%u Hz: integrated %.3f LUFS, expected -23.01", rates[r], integrated);
+        CHECK(fabs(momentary + 23.01) < 0.05, "%u Hz: momentary %.3f LUFS, expected -23.01", rates[r], momentary);
+        CHECK(fabs(shortTerm + 23.01) < 0.05, "%u Hz: short-term %.3f LUFS, expected -23.01", rates[r], shortTerm);
+        free(buf);
+    }
+}
+
+// A quiet tail 30 LU down clears the -70 LUFS absolute gate but falls under the -10 LU
+// relative gate, so it barely moves the integrated reading; the ungated mean would drop
+// by about 3 LU.
+static void test_loudness_relative_gate(void) {
+    const uint32_t rate = 48000;
+    DspLoudness m;
+    dsp_loudness_init(&m, rate, 2, NULL);
+    float* buf = (float*)malloc((size_t)rate * 2 * sizeof(float));
+    size_t frame = 0;
+    for (int s = 0; s < 10; ++s) {
+        fill_sine(buf, rate, 2, 997.0, rate, 0.1f, &frame);
+        dsp_loudness_add_f32(&m, buf, rate);
+    }
+    double loud = dsp_loudness_integrated(&m);
+    for (int s = 0; s < 10; ++s) {
+        fill_sine(buf, rate, 2, 997.0, rate, 0.1f * 0.031622777f, &frame);
+        dsp_loudness_add_f32(&m, buf, rate);
+    }
+    double gated = dsp_loudness_integrated(&m);
+    double quiet = dsp_loudness_short_term(&m);
+    CHECK(fabs(loud + 20.0) < 0.05, "stereo -20 dBFS sine integrated %.3f LUFS, expected -20.0", loud);
+    CHECK(fabs(quiet + 50.0) < 0.05, "quiet tail short-term %.3f LUFS, expected -50.0", quiet);
+    CHECK(fabs(gated - loud) < 0.1, "quiet tail moved integrated from %.3f to %.3f LUFS", loud, gated);
+    free(buf);
+}
+
+// Short-term loudness averages the last 3 s and momentary the last 400 ms: after 1.5 s of
+// silence following a steady tone, short-term reads half the energy (-3.01 LU), momentary
+// reads nothing, and 3 s of silence empties the short-term window too.
+static void test_loudness_short_term_window(void) {
+    const uint32_t rate = 48000;
+    DspLoudness m;
+    dsp_loudness_init(&m, rate, 1, NULL);
+    float* buf = (float*)calloc((size_t)rate * 5, sizeof(float));
+    size_t frame = 0;
+    fill_sine(buf, (size_t)rate * 5, 1, 997.0, rate, 0.1f, &frame);
+    dsp_loudness_add_f32(&m, buf, (size_t)rate * 5);
+    double tone = dsp_loudness_short_term(&m);
+    memset(buf, 0, (size_t)rate * 5 * sizeof(float));
+    dsp_loudness_add_f32(&m, buf, rate * 3 / 2);
+    double half = dsp_loudness_short_term(&m);
+    CHECK(fabs(half - (tone - 3.0103)) < 0.05, "short-term %.3f LUFS after 1.5 s of silence, expected %.3f", half, tone - 3.0103);
+    CHECK(dsp_loudness_momentary(&m) < -70.0, "momentary %.3f LUFS after 1.5 s of silence", dsp_loudness_momentary(&m));
+    dsp_loudness_add_f32(&m, buf, rate * 3 / 2);
+    CHECK(dsp_loudness_short_term(&m) < -70.0, "short-term %.3f LUFS after 3 s of silence", dsp_loudness_short_term(&m));
+    free(buf);
+}
+
+// Deterministic values in [-1, 1) for test signals.
+static float test_rand(uint32_t* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return (float)(int32_t)*state / 2147483648.0f;
+}
+
+// The partitioned convolver matches direct time-domain convolution, lagged by one block,
+// for an IR spanning several partitions, call sizes that straddle block boundaries, an
+// odd channel count (the last channel convolves alone and wraps to IR channel 0) and a
+// wet/dry mix.
+static void test_convolver_matches_direct(void) {
+    enum { kBlock = 64, kIrFrames = 300, kIrChannels = 2, kChannels = 3, kFrames = 2000 };
+    const float wet = 0.7f, dry = 0.4f;
+    static float ir[kIrFrames * kIrChannels];
+    static float in[kFrames * kChannels];
+    static float out[kFrames * kChannels];
+    uint32_t seed = 1;
+    for (int i = 0; i < kIrFrames * kIrChannels; ++i) {
+        ir[i] = test_rand(&seed) * expf(-(float)(i / kIrChannels) / 100.0f);
+    }
+    for (int i = 0; i < kFrames * kChannels; ++i) in[i] = out[i] = test_rand(&seed);
+
+    DspConvIr conv;
+    DspConvolver cv;
+    CHECK(dsp_conv_ir_init(&conv, ir, kIrFrames, kIrChannels, kBlock) == 0, "IR init failed");
+    CHECK(conv.partitions == (kIrFrames + kBlock - 1) / kBlock, "%u partitions for a %d-frame IR", conv.partitions, kIrFrames);
+    CHECK(dsp_convolver_init(&cv, &conv, kChannels) == 0, "convolver init failed");
+    const size_t calls[] = { 1, 37, 100, 64, 127, 3, 200 };
+    size_t done = 0;
+    for (int i = 0; done < kFrames; i = (i + 1) % (int)(sizeof(calls) / sizeof(calls[0]))) {
+        size_t n = calls[i] < kFrames - done ? calls[i] : kFrames - done;
+        dsp_convolver_process_f32(&cv, out + done * kChannels, n, wet, dry);
+        done += n;
+    }
+
+    double maxErr = 0.0;
+    for (int f = 0; f < kFrames; ++f) {
+        for (int c = 0; c < kChannels; ++c) {
+            double y = 0.0;
+            for (int k = 0; k < kIrFrames && k <= f - kBlock; ++k) {
+                y += (double)ir[k * kIrChannels + c % kIrChannels] * in[(f - kBlock - k) * kChannels + c];
+            }
+            double expected = dry * (double)in[f * kChannels + c] + wet * y;
+            double err = fabs(out[f * kChannels + c] - expected);
+            if (err > maxErr) maxErr = err;
+        }
+    }
+    CHECK(maxErr < 1e-4, "convolver differs from direct convolution by %g", maxErr);
+    dsp_convolver_free(&cv);
+    dsp_conv_ir_free(&conv);
+}
+
+// Run a resampler over all of in, offering input in chunks of inChunks[i] frames and room
+// for outChunks[i] frames (cycling), and check the inUsed contract on every call.
+static size_t resample_chunked(uint32_t inRate, uint32_t outRate, const float* in, size_t inFrames, float* out, size_t outCap,
+                               const size_t* inChunks, const size_t* outChunks, size_t chunkCount, uint32_t* history) {
+    DspResampler rs;
+    CHECK(dsp_resampler_init(&rs, inRate, outRate, 2) == 0, "resampler init failed");
+    *history = rs.len;
+    size_t read = 0, written = 0;
+    // Keep calling once the input is all read, until the buffered frames are drained.
+    for (size_t i = 0; written < outCap; i = (i + 1) % chunkCount) {
+        size_t offer = inChunks[i] < inFrames - read ? inChunks[i] : inFrames - read;
+        size_t room = outChunks[i] < outCap - written ? outChunks[i] : outCap - written;
+        size_t used = 0;
+        size_t n = dsp_resampler_process_f32(&rs, in + read * 2, offer, &used, out + written * 2, room);
+        CHECK(used <= offer, "read %zu of %zu offered frames", used, offer);
+        CHECK(n <= room, "wrote %zu frames into room for %zu", n, room);
+        // Short of room, it only stops once it has consumed everything offered.
+        CHECK(n == room || used == offer, "stopped at %zu/%zu out with %zu/%zu in", n, room, used, offer);
+        read += used;
+        written += n;
+        if (read == inFrames && n < room) break;
+    }
+    dsp_resampler_free(&rs);
+    return written;
+}
+
+// Output of a chunked run matches one whole-buffer call sample for sample, so the phase
+// carries across calls; the frame count follows from the kernel length; and a passband
+// sine comes out at its input amplitude, aligned with the input timeline.
+static void test_resampler_chunking(void) {
+    const uint32_t rates[2][2] = { { 44100, 48000 }, { 48000, 22050 } };
+    const double hz = 1000.0;
+    const float amp = 0.5f;
+    for (int r = 0; r < 2; ++r) {
+        const uint32_t inRate = rates[r][0], outRate = rates[r][1];
+        const size_t inFrames = inRate; // 1 s
+        const size_t outCap = (size_t)outRate + 64;
+        float* in = (float*)malloc(inFrames * 2 * sizeof(float));
+        float* whole = (float*)malloc(outCap * 2 * sizeof(float));
+        float* chunked = (float*)malloc(outCap * 2 * sizeof(float));
+        for (size_t f = 0; f < inFrames; ++f) {
+            double t = (double)f / inRate;
+            in[f * 2] = amp * (float)sin(2.0 * DSP_TEST_PI * hz * t);
+            in[f * 2 + 1] = amp * (float)cos(2.0 * DSP_TEST_PI * hz * t);
+        }
+
+        const size_t all[1] = { inFrames + outCap };
+        uint32_t history = 0;
+        size_t n = resample_chunked(inRate, outRate, in, inFrames, whole, outCap, all, all, 1, &history);
+        const size_t inChunks[] = { 1, 441, 7, 2048, 480, 3 };
+        const size_t outChunks[] = { 5, 1000, 1, 64, 333, 4096 };
+        size_t m = resample_chunked(inRate, outRate, in, inFrames, chunked, outCap, inChunks, outChunks, 6, &history);
+
+        // Output k reads input from floor(k * in / out) - history and needs taps frames of
+        // it, with history frames of silence primed in front.
+        DspResampler rs;
+        dsp_resampler_init(&rs, inRate, outRate, 2);
+        size_t expected = 0;
+        while ((uint64_t)expected * rs.down / rs.up + rs.taps <= inFrames + history) expected++;
+        dsp_resampler_free(&rs);
+        CHECK(n == expected, "%u -> %u: %zu frames out of 1 s, expected %zu", inRate, outRate, n, expected);
+        CHECK(m == n, "%u -> %u: chunked run wrote %zu frames, whole run %zu", inRate, outRate, m, n);
+        size_t mismatched = 0;
+        for (size_t i = 0; i < 2 * (m < n ? m : n); ++i) mismatched += chunked[i] != whole[i];
+        CHECK(mismatched == 0, "%u -> %u: %zu samples differ between chunked and whole runs", inRate, outRate, mismatched);
+
+        // Past the startup transient the output is the input sine resampled in place.
+        double maxErr = 0.0;
+        for (size_t k = 64; k < n; ++k) {
+            double t = (double)k / outRate;
+            double errL = fabs(whole[k * 2] - amp * sin(2.0 * DSP_TEST_PI * hz * t));
+            double errR = fabs(whole[k * 2 + 1] - amp * cos(2.0 * DSP_TEST_PI * hz * t));
+            if (errL > maxErr) maxErr = errL;
+            if (errR > maxErr) maxErr = errR;
+        }
+        CHECK(maxErr < 1e-3, "%u -> %u: passband sine off by %g", inRate, outRate, maxErr);
+        free(in);
+        free(whole);
+        free(chunked);
+    }
+}
+
+// Reference IMA-ADPCM decoder for one WAV block (format 0x11), written from the format
+// description rather than the encoder: per-channel 4-byte headers, then per channel
+// 4-byte words of eight nibbles, low nibble first. Returns the decoder state in
+// predictor/index so the caller can compare it with the encoder's.
+static void ima_decode_block(const uint8_t* block, uint32_t channels, uint32_t samplesPerBlock, int16_t* out, int32_t* predictor, int32_t* index) {
+    static const int steps[89] = {
+        7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+        50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+        337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+        2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+        15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+    };
+    static const int adjust[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+    for (uint32_t c = 0; c < channels; ++c) {
+        predictor[c] = (int16_t)(block[0] | (block[1] << 8));
+        index[c] = block[2];
+        out[c] = (int16_t)predictor[c];
+        block += 4;
+    }
+    for (uint32_t s = 1; s < samplesPerBlock; s += 8) {
+        for (uint32_t c = 0; c < channels; ++c) {
+            for (uint32_t k = 0; k < 8; ++k) {
+                int code = (block[k / 2] >> ((k & 1) * 4)) & 0xF;
+                int step = steps[index[c]];
+                int diff = step >> 3;
+                if (code & 4) diff += step;
+                if (code & 2) diff += step >> 1;
+                if (code & 1) diff += step >> 2;
+                int p = predictor[c] + ((code & 8) ? -diff : diff);
+                predictor[c] = p > 32767 ? 32767 : (p < -32768 ? -32768 : p);
+                int idx = index[c] + adjust[code & 7];
+                index[c] = idx < 0 ? 0 : (idx > 88 ? 88 : idx);
+                out[(size_t)(s + k) * channels + c] = (int16_t)predictor[c];
+            }
+            block += 4;
+        }
+    }
+}
+
+// Stereo blocks decode back to the input: each header carries that channel's first
+// sample and the step index the previous block ended on, the channels' nibble words
+// interleave so each channel tracks its own signal, and a sine survives with bounded
+// error once the step size has adapted.
+static void test_ima_adpcm_round_trip(void) {
+    enum { kChannels = 2, kBlockAlign = 256, kBlocks = 8 };
+    const uint32_t spb = dsp_ima_adpcm_samples_per_block(kBlockAlign, kChannels);
+    CHECK(spb == 249, "%u samples per %d-byte stereo block, expected 249", spb, kBlockAlign);
+    int16_t* in = (int16_t*)malloc((size_t)spb * kBlocks * kChannels * sizeof(int16_t));
+    int16_t* out = (int16_t*)malloc((size_t)spb * kChannels * sizeof(int16_t));
+    for (size_t f = 0; f < (size_t)spb * kBlocks; ++f) {
+        // Different frequencies and levels per channel, so swapped nibbles cannot pass.
+        in[f * 2] = (int16_t)lrint(8000.0 * sin(2.0 * DSP_TEST_PI * 440.0 * (double)f / 48000.0));
+        in[f * 2 + 1] = (int16_t)lrint(-3000.0 * sin(2.0 * DSP_TEST_PI * 1250.0 * (double)f / 48000.0) + 500.0);
+    }
+
+    DspImaAdpcm enc;
+    dsp_ima_adpcm_init(&enc);
+    int32_t decIndex[kChannels] = { 0, 0 };
+    double errSq[kChannels] = { 0.0, 0.0 }, sigSq[kChannels] = { 0.0, 0.0 };
+    int maxErr[kChannels] = { 0, 0 };
+    for (int b = 0; b < kBlocks; ++b) {
+        const int16_t* src = in + (size_t)b * spb * kChannels;
+        uint8_t block[kBlockAlign];
+        int32_t startIndex[kChannels] = { enc.index[0], enc.index[1] };
+        dsp_ima_adpcm_encode_block(&enc, src, kChannels, spb, block);
+        int32_t predictor[kChannels], index[kChannels];
+        for (int c = 0; c < kChannels; ++c) {
+            int16_t header = (int16_t)(block[c * 4] | (block[c * 4 + 1] << 8));
+            CHECK(header == src[c], "block %d channel %d: header predictor %d, first sample %d", b, c, header, src[c]);
+            CHECK(block[c * 4 + 2] == startIndex[c], "block %d channel %d: header index %d, encoder was at %d", b, c, block[c * 4 + 2], (int)startIndex[c]);
+            CHECK(b == 0 || block[c * 4 + 2] == decIndex[c], "block %d channel %d: header index %d, decoder ended at %d", b, c, block[c * 4 + 2], (int)decIndex[c]);
+            CHECK(block[c * 4 + 3] == 0, "block %d channel %d: reserved header byte set", b, c);
+        }
+        ima_decode_block(block, kChannels, spb, out, predictor, index);
+        for (int c = 0; c < kChannels; ++c) {
+            CHECK(predictor[c] == enc.predictor[c] && index[c] == enc.index[c], "block %d channel %d: decoder ended at %d/%d, encoder at %d/%d", b, c,
+                  (int)predictor[c], (int)index[c], (int)enc.predictor[c], (int)enc.index[c]);
+            decIndex[c] = index[c];
+        }
+        if (b == 0) continue; // step size still adapting from index 0
+        for (uint32_t f = 0; f < spb; ++f) {
+            for (int c = 0; c < kChannels; ++c) {
+                int err = abs(out[f * kChannels + c] - src[f * kChannels + c]);
+                if (err > maxErr[c]) maxErr[c] = err;
+                errSq[c] += (double)err * err;
+                sigSq[c] += (double)src[f * kChannels + c] * src[f * kChannels + c];
+            }
+        }
+    }
+    for (int c = 0; c < kChannels; ++c) {
+        double snr = 10.0 * log10(sigSq[c] / (errSq[c] > 0.0 ? errSq[c] : 1.0));
+        CHECK(maxErr[c] < 200, "channel %d: round trip off by up to %d", c, maxErr[c]);
+        CHECK(snr > 30.0, "channel %d: round trip SNR %.1f dB", c, snr);
+    }
+    free(in);
+    free(out);
+}
+
+// Hash seed-1234 noise of one color, rendered in uneven calls, from the float and Q15
+// renderers. Six channels cover a full SIMD group plus a remainder.
+static void noise_hashes(DspNoiseColor color, uint64_t* f32Hash, uint64_t* s16Hash) {
+    enum { kChannels = 6, kFrames = 4096 };
+    static const float gains[kChannels] = { 1.0f, 0.5f, 0.0f, 1.0f, 0.25f, 0.75f };
+    static const int32_t gainsQ15[kChannels] = { 32768, 16384, 0, 32768, 8192, 24576 };
+    static const size_t calls[] = { 1, 1000, 63, 3032 };
+    static float f32[kFrames * kChannels];
+    static int16_t s16[kFrames * kChannels];
+    DspNoise a, b;
+    dsp_noise_init(&a, color, 1234);
+    dsp_noise_init(&b, color, 1234);
+    size_t done = 0;
+    for (size_t i = 0; i < sizeof(calls) / sizeof(calls[0]); ++i) {
+        dsp_noise_render_f32(&a, f32 + done * kChannels, calls[i], kChannels, 0.5f, gains);
+        dsp_noise_render_s16(&b, s16 + done * kChannels, calls[i], kChannels, 16384, gainsQ15);
+        done += calls[i];
+    }
+    *f32Hash = dsp_fnv1a64(DSP_FNV1A64_INIT, f32, sizeof(f32));
+    *s16Hash = dsp_fnv1a64(DSP_FNV1A64_INIT, s16, sizeof(s16));
+}
+
+// Fixed-seed noise is bit-identical on every path the CPU supports and matches golden
+// hashes, so a kernel or generator change that alters rendered output shows up here.
+// The float hashes assume little-endian IEEE floats, like the rendered WAV files.
+static void test_noise_golden(void) {
+    static const struct {
+        DspNoiseColor color;
+        const char* name;
+        uint64_t f32;
+        uint64_t s16;
+    } golden[] = {
+        { DSP_NOISE_WHITE, "white", 0xd733540e70820bedull, 0x317f8ee77eeb6ef2ull },
+        { DSP_NOISE_PINK, "pink", 0xd4532fa011e7888bull, 0x51bfc12ba3128c9full },
+        { DSP_NOISE_BROWN, "brown", 0xafafdc4cd59d365full, 0x27e7605bd47f3806ull },
+    };
+    DspPath saved = dsp_active_path();
+    for (int p = 0; p < DSP_PATH_COUNT; ++p) {
+        if (dsp_set_path((DspPath)p) != 0) continue;
+        for (size_t i = 0; i < sizeof(golden) / sizeof(golden[0]); ++i) {
+            uint64_t f32Hash, s16Hash;
+            noise_hashes(golden[i].color, &f32Hash, &s16Hash);
+            CHECK(f32Hash == golden[i].f32, "%s %s noise: f32 hash %016llx, expected %016llx", dsp_path_name((DspPath)p), golden[i].name,
+                  (unsigned long long)f32Hash, (unsigned long long)golden[i].f32);
+            CHECK(s16Hash == golden[i].s16, "%s %s noise: s16 hash %016llx, expected %016llx", dsp_path_name((DspPath)p), golden[i].name,
+                  (unsigned long long)s16Hash, (unsigned long long)golden[i].s16);
+        }
+    }
+    dsp_set_path(saved);
+}
+
+// Every supported path's kernels agree with the scalar ones: conversion, noise and gains
+// bit for bit, levels with the peak and clip count exact and the sum of squares within
+// the tolerance documented on dsp_levels_f32.
+static void test_paths_match_scalar(void) {
+    enum { kChannels = 7, kFrames = 1001, kN = kChannels * kFrames };
+    static float src[kN], ref[kN], got[kN];
+    static int16_t refS16[kN], gotS16[kN];
+    static const float gains[kChannels] = { 1.0f, 0.5f, 0.0f, 2.0f, 0.25f, 0.75f, -1.0f };
+    uint32_t seed = 7;
+    for (int i = 0; i < kN; ++i) src[i] = 1.5f * test_rand(&seed);
+    // Saturation limits, round-half cases and values just inside and outside full scale.
+    const float edges[] = { 1.0f, -1.0f, 1.0001f, -1.0001f, 0.5f / 32767.0f, 1.5f / 32767.0f, -2.5f / 32767.0f, 0.0f, -0.0f, 100.0f, -100.0f };
+    for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); ++i) src[i * 13] = edges[i];
+
+    DspPath saved = dsp_active_path();
+    for (int p = 0; p < DSP_PATH_COUNT; ++p) {
+        if (p == DSP_PATH_SCALAR || !dsp_path_supported((DspPath)p)) continue;
+        const char* name = dsp_path_name((DspPath)p);
+
+        dsp_set_path(DSP_PATH_SCALAR);
+        dsp_f32_to_s16(src, refS16, kN);
+        dsp_set_path((DspPath)p);
+        dsp_f32_to_s16(src, gotS16, kN);
+        CHECK(memcmp(refS16, gotS16, sizeof(refS16)) == 0, "%s: f32_to_s16 differs from scalar", name);
+
+        for (int color = DSP_NOISE_WHITE; color <= DSP_NOISE_BROWN; ++color) {
+            DspNoise noise;
+            dsp_set_path(DSP_PATH_SCALAR);
+            dsp_noise_init(&noise, (DspNoiseColor)color, 99);
+            dsp_noise_render_f32(&noise, ref, kFrames, kChannels, 0.8f, gains);
+            dsp_set_path((DspPath)p);
+            dsp_noise_init(&noise, (DspNoiseColor)color, 99);
+            dsp_noise_render_f32(&noise, got, kFrames, kChannels, 0.8f, gains);
+            CHECK(memcmp(ref, got, sizeof(ref)) == 0, "%s: noise color %d differs from scalar", name, color);
+        }
+
+        memcpy(ref, src, sizeof(ref));
+        memcpy(got, src, sizeof(got));
+        dsp_set_path(DSP_PATH_SCALAR);
+        float refGain = dsp_gain_ramp_f32(ref, kFrames, kChannels, 0.1f, 0.003f, 1.0f);
+        dsp_channel_gains_f32(ref, kFrames, kChannels, gains);
+        dsp_set_path((DspPath)p);
+        float gotGain = dsp_gain_ramp_f32(got, kFrames, kChannels, 0.1f, 0.003f, 1.0f);
+        dsp_channel_gains_f32(got, kFrames, kChannels, gains);
+        CHECK(refGain == gotGain, "%s: gain ramp ended at %f, scalar at %f", name, gotGain, refGain);
+        CHECK(memcmp(ref, got, sizeof(ref)) == 0, "%s: gain ramp or channel gains differ from scalar", name);
+
+        // Odd lengths leave a tail for the scalar loop after the vector body.
+        const size_t lengths[] = { 3, 64, 480, (size_t)kN };
+        for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i) {
+            DspLevels a, b;
+            dsp_set_path(DSP_PATH_SCALAR);
+            dsp_levels_f32(src, lengths[i], &a);
+            dsp_set_path((DspPath)p);
+            dsp_levels_f32(src, lengths[i], &b);
+            CHECK(a.peak == b.peak && a.clipCount == b.clipCount, "%s: levels of %zu samples give peak %f / %u clips, scalar %f / %u", name, lengths[i],
+                  b.peak, b.clipCount, a.peak, a.clipCount);
+            CHECK(fabsf(a.sumSquares - b.sumSquares) <= DSP_LEVELS_SUM_TOLERANCE * a.sumSquares, "%s: sum of squares over %zu samples %f, scalar %f", name,
+                  lengths[i], b.sumSquares, a.sumSquares);
+        }
+    }
+    dsp_set_path(saved);
+}
+
+int main(void) {
+    test_limiter_decaying_peak();
+    test_gain_ramp_s16();
+    test_loudness_sine_level();
+    test_loudness_relative_gate();
+    test_loudness_short_term_window();
+    test_convolver_matches_direct();
+    test_resampler_chunking();
+    test_ima_adpcm_round_trip();
+    test_noise_golden();
+    test_paths_match_scalar();
+    if (g_failures) {
+        fprintf(stderr, "%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    printf("dsp_test: all checks passed\n");
+    return 0;
+}
@@ -1,3 +1,5 @@
+#include <math.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -7,44 +9,211 @@
 #include <unistd.h>
 #endif
 
+#include "dsp.h"
+
 #define MINIAUDIO_IMPLEMENTATION
 #include <miniaudio.h>
 
+#include "channel_map.h"
+
+// Builds configured with ALGORYTHM_FIXED_POINT default to the Q15 integer generators,
+// for boards where float math is slow; --format overrides either way.
+#if defined(ALGORYTHM_FIXED_POINT)
+#define NOISE_DEFAULT_FORMAT ma_format_s16
+#else
+#define NOISE_DEFAULT_FORMAT ma_format_f32
+#endif
+
+// Playback ramps in and out over this long so starting and stopping do not click.
+#define NOISE_FADE_MS 20
+
 typedef struct NoiseState {
     float amplitude;
+    int32_t amplitudeQ15;
+    ma_format format; // ma_format_f32 or ma_format_s16
     ma_uint32 channels;
-    uint32_t seed;
+    DspNoise noise;
+    // Fade gain and per-frame step, owned by the callback: float for f32, Q30 for s16.
+    ma_uint32 fadeFrames;
+    float fadeGain, fadeStep;
+    int32_t fadeGainQ30, fadeStepQ30;
+    atomic_int fadeOut; // set by main before stopping the device
 } NoiseState;
 
-static inline float frand_signed(uint32_t* s) {
-    *s = (*s * 1664525u) + 1013904223u; // LCG
-    float v = (float)(*s & 0x00FFFFFF) / (float)0x01000000; // [0,1)
-    return (v * 2.0f) - 1.0f; // [-1,1)
+static void fade_init(NoiseState* st, ma_uint32 sampleRate) {
+    st->fadeFrames = sampleRate * NOISE_FADE_MS / 1000;
+    st->fadeGain = 0.0f;
+    st->fadeStep = 1.0f / (float)st->fadeFrames;
+    st->fadeGainQ30 = 0;
+    st->fadeStepQ30 = DSP_Q30_ONE / (int32_t)st->fadeFrames;
+    atomic_init(&st->fadeOut, 0);
 }
 
 static void data_callback(ma_device* device, void* out, const void* in, ma_uint32 frameCount) {
     NoiseState* st = (NoiseState*)device->pUserData;
-    float* f32 = (float*)out;
-    ma_uint64 total = (ma_uint64)frameCount * st->channels;
-    for (ma_uint64 i = 0; i < total; ++i) {
-        f32[i] = frand_signed(&st->seed) * st->amplitude;
+    if (atomic_exchange_explicit(&st->fadeOut, 0, memory_order_relaxed)) {
+        st->fadeStep = -st->fadeGain / (float)st->fadeFrames;
+        st->fadeStepQ30 = -(st->fadeGainQ30 / (int32_t)st->fadeFrames + 1);
+    }
+    if (st->format == ma_format_s16) {
+        int16_t* samples = (int16_t*)out;
+        dsp_noise_render_s16(&st->noise, samples, frameCount, st->channels, st->amplitudeQ15, NULL);
+        if (st->fadeStepQ30 != 0 || st->fadeGainQ30 != DSP_Q30_ONE) {
+            int32_t target = st->fadeStepQ30 > 0 ? DSP_Q30_ONE : 0;
+            st->fadeGainQ30 = dsp_gain_ramp_s16(samples, frameCount, st->channels, st->fadeGainQ30, st->fadeStepQ30, target);
+            if (st->fadeGainQ30 == target) st->fadeStepQ30 = 0;
+        }
+    } else {
+        float* samples = (float*)out;
+        dsp_noise_render_f32(&st->noise, samples, frameCount, st->channels, st->amplitude, NULL);
+        if (st->fadeStep != 0.0f || st->fadeGain != 1.0f) {
+            float target = st->fadeStep > 0.0f ? 1.0f : 0.0f;
+            st->fadeGain = dsp_gain_ramp_f32(samples, frameCount, st->channels, st->fadeGain, st->fadeStep, target);
+            if (st->fadeGain == target) st->fadeStep = 0.0f;
+        }
     }
     (void)in;
 }
 
+// Render to a 32-bit float (or, with --format s16, 16-bit) WAV instead of playing, and
+// print the FNV-1a hash of the samples. The same arguments (including --seed) always
+// produce the same hash. Noise is generated at sampleRate; when fileRate differs it is
+// resampled on the way out (float only).
+static int render_to_file(const char* path, NoiseState* st, ma_uint32 sampleRate, ma_uint32 fileRate, ma_uint64 totalFrames) {
+    ma_encoder_config config = ma_encoder_config_init(ma_encoding_format_wav, st->format, st->channels, fileRate);
+    ma_encoder encoder;
+    if (ma_encoder_init_file(path, &config, &encoder) != MA_SUCCESS) {
+        fprintf(stderr, "Failed to open %s for writing.\n", path);
+        return 1;
+    }
+    DspResampler resampler;
+    const int resample = fileRate != sampleRate;
+    if (resample && dsp_resampler_init(&resampler, sampleRate, fileRate, st->channels) != 0) {
+        fprintf(stderr, "Failed to set up resampling from %u to %u Hz.\n", sampleRate, fileRate);
+        ma_encoder_uninit(&encoder);
+        return 1;
+    }
+    static float block[4096 * DSP_MAX_CHANNELS];
+    static float source[4096 * DSP_MAX_CHANNELS];
+    static int16_t block16[4096 * DSP_MAX_CHANNELS];
+    const ma_uint64 blockFrames = sizeof(block) / sizeof(block[0]) / st->channels;
+    size_t sourceFrames = 0, sourceUsed = 0;
+    uint64_t hash = DSP_FNV1A64_INIT;
+    int result = 0;
+    for (ma_uint64 done = 0; done < totalFrames;) {
+        ma_uint64 frames = totalFrames - done < blockFrames ? totalFrames - done : blockFrames;
+        const void* samples = block;
+        size_t bytes = (size_t)frames * st->channels * sizeof(float);
+        if (st->format == ma_format_s16) {
+            dsp_noise_render_s16(&st->noise, block16, (size_t)frames, st->channels, st->amplitudeQ15, NULL);
+            samples = block16;
+            bytes = (size_t)frames * st->channels * sizeof(int16_t);
+        } else if (resample) {
+            size_t filled = 0;
+            while (filled < frames) {
+                if (sourceUsed == sourceFrames) {
+                    sourceFrames = (size_t)blockFrames;
+                    sourceUsed = 0;
+                    dsp_noise_render_f32(&st->noise, source, sourceFrames, st->channels, st->amplitude, NULL);
+                }
+                size_t used = 0;
+                filled += dsp_resampler_process_f32(&resampler, source + sourceUsed * st->channels, sourceFrames - sourceUsed, &used,
+                    block + filled * st->channels, (size_t)frames - filled);
+                sourceUsed += used;
+            }
+        } else {
+            dsp_noise_render_f32(&st->noise, block, (size_t)frames, st->channels, st->amplitude, NULL);
+        }
+        hash = dsp_fnv1a64(hash, samples, bytes);
+        if (ma_encoder_write_pcm_frames(&encoder, samples, frames, NULL) != MA_SUCCESS) {
+            fprintf(stderr, "Failed to write %s.\n", path);
+            result = 1;
+            break;
+        }
+        done += frames;
+    }
+    if (resample) dsp_resampler_free(&resampler);
+    ma_encoder_uninit(&encoder);
+    if (result == 0) {
+        printf("Rendered %llu frames to %s\nfnv1a64=%016llx\n", (unsigned long long)totalFrames, path, (unsigned long long)hash);
+    }
+    return result;
+}
+
+static double seconds_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Time the float generators (alone and with the s16 conversion a 16-bit device needs)
+// against the Q15 generators, rendering durationSec of audio per color.
+static int run_bench(ma_uint32 sampleRate, ma_uint32 channels, int durationSec, float amplitude, uint32_t seed) {
+    static float block[4096 * DSP_MAX_CHANNELS];
+    static int16_t block16[4096 * DSP_MAX_CHANNELS];
+    const size_t blockFrames = sizeof(block) / sizeof(block[0]) / channels;
+    const size_t totalFrames = (size_t)sampleRate * (size_t)durationSec;
+    const int32_t ampQ15 = (int32_t)lrintf(amplitude * DSP_Q15_ONE);
+    printf("Benchmark: rate=%u, channels=%u, %d s of audio per run, dsp=%s\n", sampleRate, channels, durationSec, dsp_path_name(dsp_active_path()));
+    printf("%-6s %18s %18s %18s\n", "color", "f32 (s, x rt)", "f32->s16 (s, x rt)", "q15 s16 (s, x rt)");
+    for (int color = DSP_NOISE_WHITE; color <= DSP_NOISE_BROWN; ++color) {
+        double elapsed[3];
+        for (int mode = 0; mode < 3; ++mode) {
+            DspNoise noise;
+            dsp_noise_init(&noise, (DspNoiseColor)color, seed);
+            double start = seconds_now();
+            for (size_t done = 0; done < totalFrames;) {
+                size_t frames = totalFrames - done < blockFrames ? totalFrames - done : blockFrames;
+                if (mode == 2) {
+                    dsp_noise_render_s16(&noise, block16, frames, channels, ampQ15, NULL);
+                } else {
+                    dsp_noise_render_f32(&noise, block, frames, channels, amplitude, NULL);
+                    if (mode == 1) dsp_f32_to_s16(block, block16, frames * channels);
+                }
+                done += frames;
+            }
+            elapsed[mode] = seconds_now() - start;
+        }
+        static const char* const kNames[] = { "white", "pink", "brown" };
+        printf("%-6s", kNames[color]);
+        for (int mode = 0; mode < 3; ++mode) {
+            printf(" %9.3f s %5.0fx", elapsed[mode], elapsed[mode] > 0.0 ? (double)durationSec / elapsed[mode] : 0.0);
+        }
+        printf("\n");
+    }
+    return 0;
+}
+
 static void print_usage(const char* exe) {
-    fprintf(stderr, "Usage: %s [--rate N] [--channels N] [--duration S] [--amp A]\n", exe);
+    fprintf(stderr, "Usage: %s [--rate N] [--channels N] [--duration S] [--amp A] [--color C] [--seed N] [--render FILE]\n", exe);
+    fprintf(stderr, "          [--channel-map FL,FR,...] [--render-rate N] [--format f32|s16] [--bench]\n");
     fprintf(stderr, "  --rate: sample rate in Hz (default 48000)\n");
-    fprintf(stderr, "  --channels: 1 or 2 (default 2)\n");
+    fprintf(stderr, "  --channels: 1 to %d (default 2)\n", DSP_MAX_CHANNELS);
     fprintf(stderr, "  --duration: seconds to play (default 5)\n");
     fprintf(stderr, "  --amp: amplitude 0..1 (default 0.2)\n");
+    fprintf(stderr, "  --color: white, pink or brown (default white)\n");
+    fprintf(stderr, "  --seed: generator seed for a reproducible render (default: current time)\n");
+    fprintf(stderr, "  --render: write a WAV (f32 or s16 per --format) to FILE instead of playing, and print its hash\n");
+    fprintf(stderr, "  --render-rate: sample rate of the rendered file; resampled from --rate if different\n");
+    fprintf(stderr, "  --format: f32 generators, or s16 for the Q15 fixed-point ones (default %s)\n",
+        NOISE_DEFAULT_FORMAT == ma_format_s16 ? "s16" : "f32");
+    fprintf(stderr, "  --bench: time the f32 and Q15 generators for --duration seconds of audio and exit\n");
+    fprintf(stderr, "  --channel-map: speaker positions, one per channel (FL, FR, FC, LFE, SL, SR, AUX0..AUX31, ...)\n");
 }
 
 int main(int argc, char** argv) {
     ma_uint32 sampleRate = 48000;
+    ma_uint32 renderRate = 0;
     ma_uint32 channels = 2;
     int durationSec = 5;
     float amplitude = 0.2f;
+    DspNoiseColor color = DSP_NOISE_WHITE;
+    uint32_t seed = (uint32_t)time(NULL);
+    const char* renderPath = NULL;
+    ma_format format = NOISE_DEFAULT_FORMAT;
+    int bench = 0;
+    ma_channel channelMap[DSP_MAX_CHANNELS];
+    int channelMapCount = 0;
 
     for (int i = 1; i < argc; ++i) {
         if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
@@ -55,6 +224,35 @@ int main(int argc, char** argv) {
             durationSec = (int)strtol(argv[++i], NULL, 10);
         } else if (strcmp(argv[i], "--amp") == 0 && i + 1 < argc) {
             amplitude = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "--color") == 0 && i + 1 < argc) {
+            if (dsp_noise_color_from_name(argv[++i], &color) != 0) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--render") == 0 && i + 1 < argc) {
+            renderPath = argv[++i];
+        } else if (strcmp(argv[i], "--render-rate") == 0 && i + 1 < argc) {
+            renderRate = (ma_uint32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            if (strcmp(name, "f32") == 0) {
+                format = ma_format_f32;
+            } else if (strcmp(name, "s16") == 0) {
+                format = ma_format_s16;
+            } else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            bench = 1;
+        } else if (strcmp(argv[i], "--channel-map") == 0 && i + 1 < argc) {
+            channelMapCount = channel_map_parse(argv[++i], channelMap, DSP_MAX_CHANNELS);
+            if (channelMapCount <= 0) {
+                fprintf(stderr, "Invalid channel map.\n");
+                return 1;
+            }
         } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
             print_usage(argv[0]);
             return 0;
@@ -64,20 +262,41 @@ int main(int argc, char** argv) {
         }
     }
 
-    if (channels == 0 || channels > 8) channels = 2;
+    if (channelMapCount > 0) channels = (ma_uint32)channelMapCount;
+    if (channels == 0 || channels > DSP_MAX_CHANNELS) channels = 2;
     if (sampleRate < 8000) sampleRate = 8000;
+    if (renderRate == 0) renderRate = sampleRate;
+    if (renderRate < 8000) renderRate = 8000;
     if (amplitude < 0.0f) amplitude = 0.0f;
     if (amplitude > 1.0f) amplitude = 1.0f;
     if (durationSec <= 0) durationSec = 1;
 
+    if (dsp_init() != 0) {
+        fprintf(stderr, "ALGORYTHM_DSP_PATH not available here; using %s kernels.\n", dsp_path_name(dsp_active_path()));
+    }
+
+    if (bench) return run_bench(sampleRate, channels, durationSec, amplitude, seed);
+    if (format == ma_format_s16 && renderPath && renderRate != sampleRate) {
+        fprintf(stderr, "--render-rate needs --format f32; the resampler is floating point.\n");
+        return 1;
+    }
+
     NoiseState state;
     state.amplitude = amplitude;
+    state.amplitudeQ15 = (int32_t)lrintf(amplitude * DSP_Q15_ONE);
+    state.format = format;
     state.channels = channels;
-    state.seed = (uint32_t)time(NULL);
+    dsp_noise_init(&state.noise, color, seed);
+
+    if (renderPath) {
+        return render_to_file(renderPath, &state, sampleRate, renderRate, (ma_uint64)renderRate * (ma_uint64)durationSec);
+    }
 
+    fade_init(&state, sampleRate);
     ma_device_config config = ma_device_config_init(ma_device_type_playback);
-    config.playback.format = ma_format_f32;
+    config.playback.format = format;
     config.playback.channels = channels;
+    config.playback.pChannelMap = channelMapCount > 0 ? channelMap : NULL;
     config.sampleRate = sampleRate;
     config.dataCallback = data_callback;
     config.pUserData = &state;
@@ -88,8 +307,8 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    printf("Playing white noise: rate=%u, channels=%u, duration=%d s, amp=%.2f\n",
-           sampleRate, channels, durationSec, amplitude);
+    printf("Playing noise: rate=%u, channels=%u, duration=%d s, amp=%.2f, seed=%u, dsp=%s\n",
+           sampleRate, channels, durationSec, amplitude, seed, format == ma_format_s16 ? "q15" : dsp_path_name(dsp_active_path()));
 
     if (ma_device_start(&device) != MA_SUCCESS) {
         fprintf(stderr, "Failed to start device.\n");
@@ -110,6 +329,14 @@ int main(int argc, char** argv) {
     }
 #endif
 
+    // Let the fade-out play before stopping; allow a device period or two on top.
+    atomic_store_explicit(&state.fadeOut, 1, memory_order_relaxed);
+#ifdef __APPLE__
+    usleep(NOISE_FADE_MS * 2 * 1000);
+#else
+    ma_sleep(NOISE_FADE_MS * 2);
+#endif
+
     ma_device_stop(&device);
     ma_device_uninit(&device);
     printf("Done.\n");
@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <httplib.h>
+#include <cJSON.h>
+
+// End-to-end benchmark for the web server. Start the server with --null-backend so it
+// renders into memory without sound hardware, then run this against it. Each iteration
+// starts noise on a dedicated session, waits for the loopback tap to see audio, and
+// checks the captured output against the first iteration.
+
+struct BenchOptions {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    int iterations = 20;
+    int durationMs = 500;
+    int hashMs = 250;
+    int rate = 48000;
+    int channels = 2;
+    double amp = 0.2;
+    std::string color = "white";
+};
+
+struct IterationResult {
+    double clientStartUs;   // request sent -> loopback reports rendered frames
+    double serverStartUs;   // server's own request -> first non-zero sample
+    double intervalMeanUs;
+    double intervalMaxUs;
+    double jitterMeanUs;
+    double jitterMaxUs;
+    double peak;
+    double rms;
+    std::string hash;
+};
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsed_us(Clock::time_point since) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - since).count();
+}
+
+static cJSON* get_json(httplib::Client& cli, const std::string& path) {
+    auto res = cli.Get(path);
+    if (!res || res->status != 200) return nullptr;
+    return cJSON_Parse(res->body.c_str());
+}
+
+static double json_number(const cJSON* obj, const char* key) {
+    const cJSON* item = cJSON_GetObjectItemCaseSensitive(obj, key);
+    return cJSON_IsNumber(item) ? item->valuedouble : 0.0;
+}
+
+static void print_usage(const char* exe) {
+    fprintf(stderr, "Usage: %s [--host H] [--port N] [--iterations N] [--duration-ms N] [--hash-ms N]\n", exe);
+    fprintf(stderr, "          [--rate N] [--channels N] [--amp A] [--color white|pink|brown]\n");
+    fprintf(stderr, "  Run the server with --null-backend first. Exits non-zero if output checks fail.\n");
+}
+
+static bool run_iteration(httplib::Client& cli, const BenchOptions& opt, IterationResult& out) {
+    const std::string base = "/audio/sessions/bench";
+    const size_t hashFrames = (size_t)opt.rate * (size_t)opt.hashMs / 1000;
+    const std::string loopbackPath = base + "/loopback?frames=" + std::to_string(hashFrames);
+
+    auto reset = cli.Post(base + "/loopback/reset", "", "application/json");
+    if (!reset || reset->status != 200) {
+        fprintf(stderr, "loopback reset failed; is the server running with --null-backend?\n");
+        return false;
+    }
+
+    char body[256];
+    snprintf(body, sizeof(body), "{\"rate\":%d,\"channels\":%d,\"amp\":%g,\"color\":\"%s\",\"duration_ms\":%d}",
+        opt.rate, opt.channels, opt.amp, opt.color.c_str(), opt.durationMs);
+    Clock::time_point sent = Clock::now();
+    auto started = cli.Post(base + "/noise", body, "application/json");
+    if (!started || started->status != 200) {
+        fprintf(stderr, "noise request failed\n");
+        return false;
+    }
+
+    // Poll until the tap has seen armed frames, then until the hash window is filled.
+    bool sawFrames = false;
+    cJSON* loop = nullptr;
+    Clock::time_point deadline = sent + std::chrono::milliseconds(opt.durationMs + 2000);
+    while (Clock::now() < deadline) {
+        cJSON_Delete(loop);
+        loop = get_json(cli, loopbackPath);
+        if (!loop) break;
+        if (!sawFrames && json_number(loop, "frames") > 0) {
+            out.clientStartUs = elapsed_us(sent);
+            sawFrames = true;
+        }
+        if (sawFrames && json_number(loop, "hashed_frames") >= (double)hashFrames) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(sawFrames ? 10 : 1));
+    }
+    if (!loop || !sawFrames || json_number(loop, "hashed_frames") < (double)hashFrames) {
+        fprintf(stderr, "timed out waiting for rendered frames\n");
+        cJSON_Delete(loop);
+        return false;
+    }
+
+    const cJSON* jint = cJSON_GetObjectItemCaseSensitive(loop, "callback_interval_us");
+    out.intervalMeanUs = json_number(jint, "mean");
+    out.intervalMaxUs = json_number(jint, "max");
+    out.jitterMeanUs = json_number(jint, "jitter_mean");
+    out.jitterMaxUs = json_number(jint, "jitter_max");
+    out.peak = json_number(loop, "peak");
+    out.rms = json_number(loop, "rms");
+    const cJSON* jhash = cJSON_GetObjectItemCaseSensitive(loop, "hash");
+    out.hash = cJSON_IsString(jhash) && jhash->valuestring ? jhash->valuestring : "";
+    cJSON_Delete(loop);
+
+    cJSON* session = get_json(cli, base);
+    out.serverStartUs = session ? json_number(cJSON_GetObjectItemCaseSensitive(session, "first_sample_latency_us"), "last") : 0.0;
+    cJSON_Delete(session);
+
+    cli.Post(base + "/stop", "", "application/json");
+    return true;
+}
+
+static void print_stat(const char* name, std::vector<double> v) {
+    if (v.empty()) return;
+    std::sort(v.begin(), v.end());
+    double sum = 0.0;
+    for (double x : v) sum += x;
+    printf("%-28s min %9.1f  p50 %9.1f  mean %9.1f  max %9.1f\n", name, v.front(), v[v.size() / 2], sum / (double)v.size(), v.back());
+}
+
+int main(int argc, char** argv) {
+    BenchOptions opt;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) {
+            opt.host = argv[++i];
+        } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            opt.port = (int)strtol(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            opt.iterations = (int)strtol(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--duration-ms") == 0 && i + 1 < argc) {
+            opt.durationMs = (int)strtol(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--hash-ms") == 0 && i + 1 < argc) {
+            opt.hashMs = (int)strtol(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            opt.rate = (int)strtol(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--channels") == 0 && i + 1 < argc) {
+            opt.channels = (int)strtol(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--amp") == 0 && i + 1 < argc) {
+            opt.amp = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--color") == 0 && i + 1 < argc) {
+            opt.color = argv[++i];
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (opt.iterations < 1) opt.iterations = 1;
+    if (opt.hashMs < 10) opt.hashMs = 10;
+    if (opt.durationMs < opt.hashMs + 100) opt.durationMs = opt.hashMs + 100;
+
+    httplib::Client cli(opt.host, opt.port);
+    cli.set_read_timeout(5);
+    // The session may already exist from an earlier run; 409 is fine.
+    auto created = cli.Post("/audio/sessions", "{\"id\":\"bench\"}", "application/json");
+    if (!created || (created->status != 201 && created->status != 409)) {
+        fprintf(stderr, "cannot reach server at %s:%d\n", opt.host.c_str(), opt.port);
+        return 1;
+    }
+
+    std::vector<IterationResult> results;
+    for (int i = 0; i < opt.iterations; ++i) {
+        IterationResult r{};
+        if (!run_iteration(cli, opt, r)) return 1;
+        results.push_back(r);
+    }
+
+    std::vector<double> clientStart, serverStart, intervalMean, intervalMax, jitterMean, jitterMax;
+    bool ok = true;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const IterationResult& r = results[i];
+        clientStart.push_back(r.clientStartUs);
+        serverStart.push_back(r.serverStartUs);
+        intervalMean.push_back(r.intervalMeanUs);
+        intervalMax.push_back(r.intervalMaxUs);
+        jitterMean.push_back(r.jitterMeanUs);
+        jitterMax.push_back(r.jitterMaxUs);
+        // Same parameters and seed must give bit-identical output every time.
+        if (r.hash != results[0].hash) {
+            fprintf(stderr, "iteration %zu: hash %s differs from %s\n", i, r.hash.c_str(), results[0].hash.c_str());
+            ok = false;
+        }
+        if (r.peak <= 0.0) {
+            fprintf(stderr, "iteration %zu: silent output\n", i);
+            ok = false;
+        }
+        // Uniform white noise stays within amp and has an RMS of amp / sqrt(3).
+        if (opt.color == "white" && r.peak > opt.amp * 1.0001) {
+            fprintf(stderr, "iteration %zu: peak %.6f above amp %.6f\n", i, r.peak, opt.amp);
+            ok = false;
+        }
+        if (opt.color == "white" && std::fabs(r.rms - opt.amp / std::sqrt(3.0)) > 0.05 * opt.amp) {
+            fprintf(stderr, "iteration %zu: rms %.6f, expected %.6f\n", i, r.rms, opt.amp / std::sqrt(3.0));
+            ok = false;
+        }
+    }
+
+    printf("%d iterations, %d Hz, %d ch, %s noise, hash window %d ms\n", opt.iterations, opt.rate, opt.channels, opt.color.c_str(), opt.hashMs);
+    print_stat("time to first sample (us)", clientStart);
+    print_stat("server first sample (us)", serverStart);
+    print_stat("callback interval (us)", intervalMean);
+    print_stat("callback interval max (us)", intervalMax);
+    print_stat("callback jitter (us)", jitterMean);
+    print_stat("callback jitter max (us)", jitterMax);
+    printf("output hash %s: %s\n", results[0].hash.c_str(), ok ? "ok" : "MISMATCH");
+    return ok ? 0 : 1;
+}
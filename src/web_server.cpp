@@ -1,223 +1,2685 @@
+#include <algorithm>
 #include <atomic>
+#include <condition_variable>
 #include <mutex>
 #include <string>
 #include <thread>
 #include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <vector>
+#include <functional>
+#include <list>
+#include <memory>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <httplib.h>
 #include <cJSON.h>
 
 #include <simpleble/SimpleBLE.h>
 
+#include "dsp.h"
+#include "dsp_pipeline.hpp"
+
 #define MINIAUDIO_IMPLEMENTATION
 #include <miniaudio.h>
 
-// Simple shared audio context for device enumeration and ID retention.
-static std::mutex g_audioMutex;
-static ma_context g_ctx;
-static bool g_ctx_inited = false;
-static int g_selectedPlaybackIndex = -1;
+#include "channel_map.h"
+
+// Simple shared audio context for device enumeration and ID retention.
+static std::mutex g_audioMutex;
+static ma_context g_ctx;
+static std::atomic<bool> g_ctx_inited{false};
+// Benchmark mode: force miniaudio's null backend (no sound hardware needed) and record
+// each session's rendered output in memory. Set from the command line before startup.
+static bool g_nullBackend = false;
+static bool g_loopbackEnabled = false;
+// Live streams render with the Q15 integer generators instead of float. Session playback
+// keeps its float chain (filters, reverb, loudness, limiter) either way.
+#if defined(ALGORYTHM_FIXED_POINT)
+static bool g_fixedPoint = true;
+#else
+static bool g_fixedPoint = false;
+#endif
+
+// Devices are selected by a stable key: the backend ID bytes in hex, trailing zero
+// bytes trimmed. The key decodes back to an ma_device_id, so a persisted selection
+// can be opened at startup before any enumeration has happened.
+struct DeviceSelection {
+    std::string key; // empty selects the backend default
+    ma_device_id id;
+};
+
+static DeviceSelection g_selectedCapture; // playback selections belong to sessions
+static const char* kDeviceStateFile = "algorythm_devices.json";
+
+static std::string device_key(const ma_device_id& id) {
+    static const char* hex = "0123456789abcdef";
+    const ma_uint8* bytes = (const ma_uint8*)&id;
+    size_t n = sizeof(ma_device_id);
+    while (n > 1 && bytes[n - 1] == 0) --n;
+    std::string key;
+    key.reserve(n * 2);
+    for (size_t i = 0; i < n; ++i) {
+        key += hex[bytes[i] >> 4];
+        key += hex[bytes[i] & 0x0F];
+    }
+    return key;
+}
+
+static int hex_nibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    c = (char)tolower((unsigned char)c);
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+static bool device_id_from_key(const std::string& key, ma_device_id* out) {
+    if (key.empty() || key.size() % 2 != 0 || key.size() / 2 > sizeof(ma_device_id)) return false;
+    ma_device_id id;
+    memset(&id, 0, sizeof(id));
+    ma_uint8* bytes = (ma_uint8*)&id;
+    for (size_t i = 0; i < key.size(); i += 2) {
+        int hi = hex_nibble(key[i]);
+        int lo = hex_nibble(key[i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        bytes[i / 2] = (ma_uint8)((hi << 4) | lo);
+    }
+    *out = id;
+    return true;
+}
+
+// Initialize the shared context once. Later calls only read the flag, so playback
+// sessions do not serialize on g_audioMutex.
+static bool ensure_audio_context() {
+    if (g_ctx_inited.load(std::memory_order_acquire)) return true;
+    std::lock_guard<std::mutex> lock(g_audioMutex);
+    if (!g_ctx_inited.load(std::memory_order_relaxed)) {
+        const ma_backend nullBackend[] = { ma_backend_null };
+        if (ma_context_init(g_nullBackend ? nullBackend : nullptr, g_nullBackend ? 1 : 0, nullptr, &g_ctx) != MA_SUCCESS) {
+            // Failed; leave uninitialized
+            return false;
+        }
+        g_ctx_inited.store(true, std::memory_order_release);
+    }
+    return true;
+}
+
+// Immutable, versioned view of the device lists. The watcher thread is the only
+// caller of ma_context_get_devices; it publishes a new snapshot with an atomic
+// shared_ptr swap, so HTTP handlers and playback start never enumerate or wait on
+// g_audioMutex for it.
+struct DeviceSnapshot {
+    ma_uint64 version = 0;
+    std::vector<ma_device_info> playback; // enumeration order, for display
+    std::vector<ma_device_info> capture;
+    std::unordered_map<std::string, ma_device_info> playbackByKey;
+    std::unordered_map<std::string, ma_device_info> captureByKey;
+};
+
+static std::shared_ptr<const DeviceSnapshot> g_deviceSnapshot;
+
+static std::shared_ptr<const DeviceSnapshot> device_snapshot() {
+    return std::atomic_load(&g_deviceSnapshot);
+}
+
+// Resolve a selection to a device ID. Without a snapshot yet, trust the decoded key;
+// with one, a device that has disappeared falls back to the default.
+static bool resolve_selection(const DeviceSelection& sel, const std::unordered_map<std::string, ma_device_info>* byKey, ma_device_id* out) {
+    if (sel.key.empty()) return false;
+    if (!byKey) {
+        *out = sel.id;
+        return true;
+    }
+    auto it = byKey->find(sel.key);
+    if (it == byKey->end()) return false;
+    *out = it->second.id;
+    return true;
+}
+
+// Map an API request (key, or legacy positional index) to a selection. Returns false
+// if it names nothing; an empty key or index -1 selects the default device.
+static bool selection_from_request(const httplib::Request& req, bool capture, DeviceSelection* out) {
+    DeviceSelection sel;
+    memset(&sel.id, 0, sizeof(sel.id));
+    if (req.has_param("key")) {
+        sel.key = req.get_param_value("key");
+        if (!sel.key.empty() && !device_id_from_key(sel.key, &sel.id)) return false;
+    } else {
+        int idx = -1;
+        try { idx = std::stoi(req.get_param_value("index")); } catch(...) { idx = -1; }
+        if (idx >= 0) {
+            auto snap = device_snapshot();
+            const std::vector<ma_device_info>* list = snap ? (capture ? &snap->capture : &snap->playback) : nullptr;
+            if (!list || (size_t)idx >= list->size()) return false;
+            sel.id = (*list)[idx].id;
+            sel.key = device_key(sel.id);
+        }
+    }
+    *out = sel;
+    return true;
+}
+
+// The watcher rescans at startup and again only when something suggests a change: a
+// notification from an active device (reroute, stop, interruption) or a slow fallback
+// rescan, since miniaudio exposes no context-level hot-plug callback. Clients are told
+// about new versions through /audio/events.
+struct DeviceWatcher {
+    std::mutex mutex; // guards everything below
+    std::condition_variable wake;    // rescan requests and shutdown
+    std::condition_variable changed; // published version bumps for SSE clients
+    ma_uint64 version = 0;
+    bool rescanRequested = false;
+    bool stop = false;
+    std::chrono::seconds fallbackInterval{30};
+    std::thread thread;
+};
+
+static DeviceWatcher g_deviceWatcher;
+
+static void request_device_rescan() {
+    {
+        std::lock_guard<std::mutex> lock(g_deviceWatcher.mutex);
+        g_deviceWatcher.rescanRequested = true;
+    }
+    g_deviceWatcher.wake.notify_one();
+}
+
+// Set while the server itself stops a device; defined once the device states are.
+static bool device_stopping_on_purpose(ma_device* device);
+
+static void device_notification_callback(const ma_device_notification* pNotification) {
+    switch (pNotification->type) {
+    case ma_device_notification_type_stopped:
+        // Stops the server makes itself are not device changes; only a stop nobody
+        // asked for hints that a device went away.
+        if (!device_stopping_on_purpose(pNotification->pDevice)) request_device_rescan();
+        break;
+    case ma_device_notification_type_rerouted:
+    case ma_device_notification_type_interruption_began:
+    case ma_device_notification_type_interruption_ended:
+        request_device_rescan();
+        break;
+    default:
+        break;
+    }
+}
+
+static bool same_devices(const std::vector<ma_device_info>& a, const std::vector<ma_device_info>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (memcmp(&a[i].id, &b[i].id, sizeof(ma_device_id)) != 0) return false;
+        if (strcmp(a[i].name, b[i].name) != 0) return false;
+        if (a[i].isDefault != b[i].isDefault) return false;
+    }
+    return true;
+}
+
+static void device_watcher_thread() {
+    DeviceWatcher& w = g_deviceWatcher;
+    bool ctxReady = g_ctx_inited.load(std::memory_order_acquire);
+    for (;;) {
+        ma_device_info* pPlaybackInfos = nullptr;
+        ma_uint32 playbackCount = 0;
+        ma_device_info* pCaptureInfos = nullptr;
+        ma_uint32 captureCount = 0;
+        if (ctxReady && ma_context_get_devices(&g_ctx, &pPlaybackInfos, &playbackCount, &pCaptureInfos, &captureCount) == MA_SUCCESS) {
+            auto next = std::make_shared<DeviceSnapshot>();
+            next->playback.assign(pPlaybackInfos, pPlaybackInfos + playbackCount);
+            next->capture.assign(pCaptureInfos, pCaptureInfos + captureCount);
+            for (const ma_device_info& info : next->playback) next->playbackByKey.emplace(device_key(info.id), info);
+            for (const ma_device_info& info : next->capture) next->captureByKey.emplace(device_key(info.id), info);
+            auto prev = device_snapshot();
+            if (!prev || !same_devices(prev->playback, next->playback) || !same_devices(prev->capture, next->capture)) {
+                next->version = prev ? prev->version + 1 : 1;
+                std::atomic_store(&g_deviceSnapshot, std::shared_ptr<const DeviceSnapshot>(std::move(next)));
+                std::lock_guard<std::mutex> lock(w.mutex);
+                w.version++;
+                w.changed.notify_all();
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(w.mutex);
+        w.wake.wait_for(lock, w.fallbackInterval, [&w]() { return w.stop || w.rescanRequested; });
+        if (w.stop) return;
+        w.rescanRequested = false;
+    }
+}
+
+static void device_watcher_start() {
+    if (const char* env = getenv("ALGORYTHM_DEVICE_RESCAN_S")) {
+        long secs = strtol(env, nullptr, 10);
+        if (secs > 0) g_deviceWatcher.fallbackInterval = std::chrono::seconds(secs);
+    }
+    g_deviceWatcher.thread = std::thread(device_watcher_thread);
+}
+
+static void device_watcher_stop() {
+    {
+        std::lock_guard<std::mutex> lock(g_deviceWatcher.mutex);
+        g_deviceWatcher.stop = true;
+    }
+    g_deviceWatcher.wake.notify_all();
+    g_deviceWatcher.changed.notify_all();
+    if (g_deviceWatcher.thread.joinable()) g_deviceWatcher.thread.join();
+}
+
+static std::string render_ble_list() {
+    using namespace SimpleBLE;
+    std::string html;
+    html += "<table><thead><tr><th>Name</th><th>Address</th><th>Status</th><th>Action</th></tr></thead><tbody>";
+    try {
+        auto adapters = Adapter::get_adapters();
+        if (adapters.empty()) {
+            html += "<tr><td colspan=4>No adapters found</td></tr>";
+        } else {
+            auto adapter = adapters.front();
+            auto peripherals = adapter.get_paired_peripherals();
+            if (peripherals.empty()) {
+                html += "<tr><td colspan=4>No devices found</td></tr>";
+            } else {
+                for (auto& p : peripherals) {
+                    auto name = p.identifier();
+                    auto addr = p.address();
+                    bool connected = false;
+                    try { connected = p.is_connected(); } catch(...) { connected = false; }
+                    html += "<tr>";
+                    html += std::string("<td>") + (name.empty()?"&lt;unknown&gt;":name) + "</td>";
+                    html += std::string("<td>") + addr + "</td>";
+                    html += std::string("<td>") + (connected?"connected":"disconnected") + "</td>";
+                    html += std::string("<td><button hx-post=\"/ble/toggle?address=") + addr + "\" hx-target=\"#ble-list\" hx-swap=\"outerHTML\">Toggle</button></td>";
+                    html += "</tr>";
+                }
+            }
+        }
+    } catch(...) {
+        html += "<tr><td colspan=4>Error listing BLE devices</td></tr>";
+    }
+    html += "</tbody></table>";
+    return std::string("<div id=\"ble-list\">") + html + "</div>";
+}
+
+static std::string render_capture_list() {
+    if (!ensure_audio_context()) {
+        return "<div id=\"capture-list\"><em>Audio context init failed</em></div>";
+    }
+    std::string selected;
+    {
+        std::lock_guard<std::mutex> lock(g_audioMutex);
+        selected = g_selectedCapture.key;
+    }
+
+    auto snap = device_snapshot();
+    if (!snap) {
+        return "<div id=\"capture-list\"><em>Failed to enumerate devices</em></div>";
+    }
+    const std::vector<ma_device_info>& capture = snap->capture;
+
+    std::string html;
+    html += "<ul>";
+    for (size_t i = 0; i < capture.size(); ++i) {
+        const char* name = capture[i].name;
+        std::string key = device_key(capture[i].id);
+        bool active = (key == selected);
+        html += std::string("<li>") + (active ? "<strong>" : "") + name + (active ? "</strong>" : "");
+        html += std::string(" <button hx-post=\"/audio/capture/select?key=") + key + "\" hx-target=\"#capture-list\" hx-swap=\"outerHTML\">Select</button>";
+        html += "</li>";
+    }
+    html += "</ul>";
+    return std::string("<div id=\"capture-list\">") + html + "</div>";
+}
+
+// Decoded PCM clip. Immutable once published so playback can hold it without locks.
+struct DecodedClip {
+    std::vector<ma_uint8> pcm;
+    ma_format format;
+    ma_uint32 channels;
+    ma_uint32 sampleRate;
+    ma_uint64 frameCount;
+};
+
+// Bounded LRU cache of decoded clips shared by all playback requests. Entries are
+// accounted by PCM byte size; evicted clips stay alive while a device still plays them.
+struct ClipCache {
+    struct Entry {
+        std::string key;
+        std::shared_ptr<const DecodedClip> clip;
+        size_t bytes;
+    };
+    std::mutex mutex;
+    std::list<Entry> lru; // front = most recently used
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    size_t bytes = 0;
+    size_t capacityBytes = 0;
+    ma_uint64 hits = 0;
+    ma_uint64 misses = 0;
+    ma_uint64 evictions = 0;
+};
+
+static ClipCache g_clipCache;
+static const size_t kClipCacheBytes = 32u * 1024u * 1024u;
+static const char* kClipDir = "clips/";
+
+static std::string clip_cache_key(const std::string& path, ma_format format, ma_uint32 channels, ma_uint32 rate) {
+    return path + "|" + std::to_string((int)format) + "|" + std::to_string(channels) + "|" + std::to_string(rate);
+}
+
+// Drop least recently used entries until the cache fits its budget. Caller holds cache.mutex.
+static void clip_cache_trim(ClipCache& cache) {
+    while (cache.bytes > cache.capacityBytes && !cache.lru.empty()) {
+        ClipCache::Entry& victim = cache.lru.back();
+        cache.bytes -= victim.bytes;
+        cache.index.erase(victim.key);
+        cache.lru.pop_back();
+        cache.evictions++;
+    }
+}
+
+static std::shared_ptr<const DecodedClip> decode_clip(const std::string& path, ma_format format, ma_uint32 channels, ma_uint32 rate) {
+    ma_decoder_config config = ma_decoder_config_init(format, channels, rate);
+    ma_uint64 frameCount = 0;
+    void* pFrames = nullptr;
+    if (ma_decode_file(path.c_str(), &config, &frameCount, &pFrames) != MA_SUCCESS) {
+        return nullptr;
+    }
+    auto clip = std::make_shared<DecodedClip>();
+    size_t bytes = (size_t)frameCount * ma_get_bytes_per_frame(format, channels);
+    clip->pcm.assign((const ma_uint8*)pFrames, (const ma_uint8*)pFrames + bytes);
+    clip->format = format;
+    clip->channels = channels;
+    clip->sampleRate = rate;
+    clip->frameCount = frameCount;
+    ma_free(pFrames, nullptr);
+    return clip;
+}
+
+static std::shared_ptr<const DecodedClip> clip_cache_get(ClipCache& cache, const std::string& path, ma_format format, ma_uint32 channels, ma_uint32 rate) {
+    std::string key = clip_cache_key(path, format, channels, rate);
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        auto it = cache.index.find(key);
+        if (it != cache.index.end()) {
+            cache.lru.splice(cache.lru.begin(), cache.lru, it->second);
+            cache.hits++;
+            return it->second->clip;
+        }
+        cache.misses++;
+    }
+
+    // Decode without holding the lock so hits on other clips are not blocked.
+    std::shared_ptr<const DecodedClip> clip = decode_clip(path, format, channels, rate);
+    if (!clip) return nullptr;
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    auto it = cache.index.find(key);
+    if (it != cache.index.end()) {
+        // Another request decoded the same clip meanwhile; keep the cached copy.
+        cache.lru.splice(cache.lru.begin(), cache.lru, it->second);
+        return it->second->clip;
+    }
+    size_t bytes = clip->pcm.size();
+    if (bytes > cache.capacityBytes) {
+        return clip; // Too large to cache; play it uncached.
+    }
+    cache.lru.push_front(ClipCache::Entry{key, clip, bytes});
+    cache.index[key] = cache.lru.begin();
+    cache.bytes += bytes;
+    clip_cache_trim(cache);
+    return clip;
+}
+
+// Resolve a client supplied file name inside dir (clips unless given), rejecting anything
+// that could escape it.
+static bool resolve_clip_path(const std::string& name, std::string& out, const char* dir = kClipDir) {
+    if (name.empty() || name[0] == '/' || name[0] == '\\' || name.find("..") != std::string::npos) {
+        return false;
+    }
+    out = std::string(dir) + name;
+    return true;
+}
+
+// Impulse responses for the convolution reverb, decoded to stereo at the output rate with
+// their partition spectra computed once. Sessions playing the same IR at the same rate
+// share one copy.
+struct ConvolutionIr {
+    DspConvIr ir{};
+    ConvolutionIr() = default;
+    ConvolutionIr(const ConvolutionIr&) = delete;
+    ConvolutionIr& operator=(const ConvolutionIr&) = delete;
+    ~ConvolutionIr() { dsp_conv_ir_free(&ir); }
+};
+
+struct IrCache {
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<const ConvolutionIr>> entries;
+    ma_uint64 hits = 0;
+    ma_uint64 misses = 0;
+};
+
+static IrCache g_irCache;
+static const char* kIrDir = "irs/";
+static const ma_uint32 kIrBlockFrames = 256;  // partition size and wet-path latency
+static const ma_uint32 kIrMaxSeconds = 3;
+static const size_t kIrCacheEntries = 8;
+
+static std::shared_ptr<const ConvolutionIr> ir_cache_get(IrCache& cache, const std::string& path, ma_uint32 rate) {
+    std::string key = path + "|" + std::to_string(rate);
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        auto it = cache.entries.find(key);
+        if (it != cache.entries.end()) {
+            cache.hits++;
+            return it->second;
+        }
+        cache.misses++;
+    }
+
+    std::shared_ptr<const DecodedClip> pcm = decode_clip(path, ma_format_f32, 2, rate);
+    if (!pcm || pcm->frameCount == 0) return nullptr;
+    size_t frames = (size_t)std::min<ma_uint64>(pcm->frameCount, (ma_uint64)rate * kIrMaxSeconds);
+    auto ir = std::make_shared<ConvolutionIr>();
+    if (dsp_conv_ir_init(&ir->ir, (const float*)pcm->pcm.data(), frames, 2, kIrBlockFrames) != 0) return nullptr;
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    auto it = cache.entries.find(key);
+    if (it != cache.entries.end()) return it->second;
+    if (cache.entries.size() >= kIrCacheEntries) {
+        // Forget IRs no device is using; in-use ones stay alive through their owners anyway.
+        for (auto e = cache.entries.begin(); e != cache.entries.end();) {
+            e = e->second.use_count() == 1 ? cache.entries.erase(e) : std::next(e);
+        }
+    }
+    if (cache.entries.size() < kIrCacheEntries) cache.entries[key] = ir;
+    return ir;
+}
+
+// Per-device convolution state for one published reverb. The callback owns it while
+// the control block points at it; the OutputDevice keeps it alive.
+struct Reverb {
+    std::shared_ptr<const ConvolutionIr> ir;
+    DspConvolver cv{};
+    float wet;
+    float dry;
+    bool ready;
+
+    Reverb(std::shared_ptr<const ConvolutionIr> impulse, ma_uint32 channels, float wetGain, float dryGain)
+        : ir(std::move(impulse)), wet(wetGain), dry(dryGain) {
+        ready = dsp_convolver_init(&cv, &ir->ir, channels) == 0;
+    }
+    Reverb(const Reverb&) = delete;
+    Reverb& operator=(const Reverb&) = delete;
+    ~Reverb() {
+        if (ready) dsp_convolver_free(&cv);
+    }
+};
+
+// Parameters handed from HTTP threads to the audio callback without locks. The single
+// writer (holding g_audioMutex) makes seq odd, stores the fields, then makes it even;
+// the callback applies an even seq it has not seen yet and otherwise keeps its current
+// parameters until the next block.
+struct PlaybackControl {
+    std::atomic<ma_uint32> seq{0};
+    std::atomic<ma_uint32> applied{0}; // last seq the callback switched to
+    std::atomic<bool> armed{false};
+    std::atomic<float> amplitude{0.0f};
+    std::atomic<int> color{DSP_NOISE_WHITE};
+    std::atomic<ma_uint32> seed{0};
+    std::atomic<const DecodedClip*> clip{nullptr}; // kept alive by OutputDevice
+    std::atomic<Reverb*> reverb{nullptr};          // likewise
+    std::atomic<ma_int64> armedAtNs{0};
+    std::atomic<ma_uint32> fadeInFrames{0}; // ramp up from silence when armed
+    std::atomic<ma_uint64> startCursor{0};  // clip frame to start from
+    std::atomic<bool> unityGains{true};
+    std::atomic<float> gains[DSP_MAX_CHANNELS]; // read only when unityGains is false
+    std::atomic<int> filterSections{0};          // biquads applied to noise, 0-2
+    std::atomic<float> biquad[2][5];             // b0 b1 b2 a1 a2 per section
+    // Independent of seq: ramp the current source down to silence over this many frames.
+    std::atomic<ma_uint32> fadeOutFrames{0};
+};
+
+// Time from a playback request to the first non-zero sample leaving the callback.
+// Written only by the audio callbacks of one session, one device at a time.
+struct StartLatency {
+    std::atomic<ma_uint64> count{0};
+    std::atomic<ma_uint64> lastUs{0};
+    std::atomic<ma_uint64> minUs{0};
+    std::atomic<ma_uint64> maxUs{0};
+    std::atomic<ma_uint64> sumUs{0};
+};
+
+struct NoiseState;
+
+// In-memory sink for a session's rendered output, enabled in benchmark mode. The audio
+// callback is the writer; HTTP threads ask for a reset through a flag (or clear it
+// directly while no device runs) and read relaxed counters. Samples are stored from
+// the first armed block after a reset until the buffer is full.
+// While a device switch crossfades, two callbacks run at once, so only the device
+// named by owner writes; busy lets loopback_handoff wait out a write in progress.
+struct LoopbackTap {
+    static const size_t kCapacitySamples = 48000 * 2 * 4; // 4 s of 48 kHz stereo
+
+    std::atomic<const NoiseState*> owner{nullptr};
+    std::atomic<bool> busy{false};
+    std::atomic<bool> resetRequested{false};
+    std::atomic<ma_uint32> channels{0};
+    std::atomic<ma_uint32> sampleRate{0};
+    std::atomic<ma_uint64> callbacks{0};
+    std::atomic<ma_uint64> frames{0}; // armed frames rendered
+    std::atomic<double> sumSquares{0.0};
+    std::atomic<float> peak{0.0f};
+    // Callback timing: interval between callbacks and its deviation from frameCount / rate.
+    std::atomic<ma_int64> lastCallbackNs{0};
+    std::atomic<ma_uint64> intervals{0};
+    std::atomic<double> intervalSumUs{0.0};
+    std::atomic<double> intervalMaxUs{0.0};
+    std::atomic<double> jitterSumUs{0.0};
+    std::atomic<double> jitterMaxUs{0.0};
+    std::atomic<size_t> captured{0};
+    std::unique_ptr<std::atomic<float>[]> samples{new std::atomic<float>[kCapacitySamples]};
+};
+
+// Output loudness of one session. The callback copies the first
+// DSP_LOUDNESS_MAX_CHANNELS channels of each block into a lock-free ring, before
+// normalization gain, and the loudness worker K-weights and gates them off the audio
+// thread. With a target set, the worker publishes the gain that brings short-term
+// loudness to it and the callback ramps toward that gain.
+struct LoudnessMeter {
+    static const size_t kRingSamples = 1 << 17; // ~340 ms of 8 channels at 48 kHz
+    std::unique_ptr<std::atomic<float>[]> ring{new std::atomic<float>[kRingSamples]};
+    std::atomic<ma_uint64> written{0}; // samples
+    std::atomic<ma_uint32> channels{0};
+    std::atomic<ma_uint64> layoutStart{0}; // sample where the current channel count began
+    std::atomic<ma_uint32> sampleRate{0};
+    // BS.1770 channel weights for the open output; version bumps when they change.
+    std::atomic<float> weights[DSP_LOUDNESS_MAX_CHANNELS];
+    std::atomic<ma_uint32> weightsVersion{0};
+    std::atomic<bool> resetRequested{false};
+    std::atomic<bool> normalize{false};
+    std::atomic<float> targetLufs{-23.0f};
+    std::atomic<float> gain{1.0f};
+    std::atomic<double> momentary{DSP_LOUDNESS_FLOOR};
+    std::atomic<double> shortTerm{DSP_LOUDNESS_FLOOR};
+    std::atomic<double> integrated{DSP_LOUDNESS_FLOOR};
+    std::atomic<ma_uint64> droppedSamples{0};
+    // Owned by the worker.
+    DspLoudness meter;
+    ma_uint64 readPos = 0;
+    ma_uint32 meterChannels = 0;
+    ma_uint32 meterRate = 0;
+    ma_uint32 meterVersion = 0;
+};
+
+// Output limiter settings and gain-reduction meter for one session. The limiter itself
+// lives with each device since its delay line depends on the channel count.
+struct LimiterControl {
+    std::atomic<bool> enabled{false};
+    std::atomic<float> ceiling{0.891251f}; // linear, -1 dBFS
+    std::atomic<float> gainReductionDb{0.0f}; // last block, positive dB
+    std::atomic<float> maxGainReductionDb{0.0f};
+    std::atomic<ma_uint64> limitedBlocks{0};
+};
+
+static const float kLimiterLookaheadMs = 2.0f;
+static const float kLimiterReleaseMs = 60.0f;
+
+static void limiter_meter(LimiterControl& lc, float minGain) {
+    float db = minGain < 1.0f ? -20.0f * log10f(minGain) : 0.0f;
+    lc.gainReductionDb.store(db, std::memory_order_relaxed);
+    if (db > lc.maxGainReductionDb.load(std::memory_order_relaxed)) lc.maxGainReductionDb.store(db, std::memory_order_relaxed);
+    if (db > 0.0f) lc.limitedBlocks.store(lc.limitedBlocks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+// Seconds over which the callback moves to a new normalization gain.
+static const float kNormalizeRampSeconds = 0.5f;
+static const float kNormalizeMinGainDb = -30.0f;
+static const float kNormalizeMaxGainDb = 12.0f;
+
+static void loudness_push(LoudnessMeter& m, const float* samples, ma_uint32 frameCount, ma_uint32 channels, ma_uint32 sampleRate) {
+    ma_uint32 metered = std::min<ma_uint32>(channels, DSP_LOUDNESS_MAX_CHANNELS);
+    if (m.channels.load(std::memory_order_relaxed) != metered) {
+        // Frames of the new layout start here, whatever the old one left in the ring.
+        m.layoutStart.store(m.written.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m.channels.store(metered, std::memory_order_release);
+    }
+    if (m.sampleRate.load(std::memory_order_relaxed) != sampleRate) m.sampleRate.store(sampleRate, std::memory_order_relaxed);
+    ma_uint64 w = m.written.load(std::memory_order_relaxed);
+    const size_t mask = LoudnessMeter::kRingSamples - 1;
+    for (ma_uint32 f = 0; f < frameCount; ++f) {
+        for (ma_uint32 c = 0; c < metered; ++c) {
+            m.ring[(w + (ma_uint64)f * metered + c) & mask].store(samples[(size_t)f * channels + c], std::memory_order_relaxed);
+        }
+    }
+    m.written.store(w + (ma_uint64)frameCount * metered, std::memory_order_release);
+}
+
+static void loopback_clear(LoopbackTap& tap) {
+    tap.callbacks.store(0, std::memory_order_relaxed);
+    tap.frames.store(0, std::memory_order_relaxed);
+    tap.sumSquares.store(0.0, std::memory_order_relaxed);
+    tap.peak.store(0.0f, std::memory_order_relaxed);
+    tap.lastCallbackNs.store(0, std::memory_order_relaxed);
+    tap.intervals.store(0, std::memory_order_relaxed);
+    tap.intervalSumUs.store(0.0, std::memory_order_relaxed);
+    tap.intervalMaxUs.store(0.0, std::memory_order_relaxed);
+    tap.jitterSumUs.store(0.0, std::memory_order_relaxed);
+    tap.jitterMaxUs.store(0.0, std::memory_order_relaxed);
+    tap.captured.store(0, std::memory_order_release);
+}
+
+// Noise chains the callback can run. Unfiltered noise stays on dsp_noise_render_f32; a
+// filter selects one of these, each compiled into a single fused loop.
+using FilteredNoise = decltype(dsp::Noise{} | dsp::Biquad{} | dsp::ChannelGains{});
+using SteepFilteredNoise = decltype(dsp::Noise{} | dsp::Biquad{} | dsp::Biquad{} | dsp::ChannelGains{});
+
+struct NoiseState {
+    ma_uint32 channels;
+    std::atomic<bool> stopping{false}; // set before the server stops the device itself
+    PlaybackControl control;
+    std::atomic<ma_uint64> clipPosition{0}; // published clip cursor for device handover
+    StartLatency* latency; // owning session's measurements
+    LoopbackTap* loopback; // owning session's tap, null unless benchmarking
+    LoudnessMeter* loudness; // owning session's meter
+    LimiterControl* limiterControl; // owning session's limiter settings
+    // Owned by the callback.
+    ma_uint32 seenSeq;
+    bool armed;
+    float amplitude;
+    DspNoise noise;
+    const DecodedClip* clip; // when set, play this clip instead of noise
+    Reverb* reverb;
+    ma_uint64 clipCursor;
+    ma_int64 armedAtNs; // pending time-to-first-sample measurement
+    float fadeGain;
+    float fadeStep;
+    bool fadingOut; // latched once a device switch starts fading this device out
+    bool unityGains;
+    float gains[DSP_MAX_CHANNELS]; // per-channel gain, 0 = muted
+    int filterSections;
+    FilteredNoise filtered;
+    SteepFilteredNoise steep;
+    float normGain;   // loudness normalization, applied after metering
+    float normTarget;
+    float normStep;
+    DspLimiter limiter; // allocated once the device is initialized
+    bool limiterReady;
+    bool limiterActive;
+};
+
+static ma_int64 steady_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void record_start_latency(StartLatency& l, ma_int64 armedAtNs) {
+    ma_uint64 us = (ma_uint64)((steady_now_ns() - armedAtNs) / 1000);
+    ma_uint64 n = l.count.load(std::memory_order_relaxed);
+    if (n == 0 || us < l.minUs.load(std::memory_order_relaxed)) l.minUs.store(us, std::memory_order_relaxed);
+    if (us > l.maxUs.load(std::memory_order_relaxed)) l.maxUs.store(us, std::memory_order_relaxed);
+    l.lastUs.store(us, std::memory_order_relaxed);
+    l.sumUs.store(l.sumUs.load(std::memory_order_relaxed) + us, std::memory_order_relaxed);
+    l.count.store(n + 1, std::memory_order_relaxed);
+}
+
+static void apply_playback_control(NoiseState* st) {
+    PlaybackControl& ctl = st->control;
+    ma_uint32 seq = ctl.seq.load(std::memory_order_acquire);
+    if (seq == st->seenSeq || (seq & 1u)) return;
+    bool armed = ctl.armed.load(std::memory_order_relaxed);
+    float amplitude = ctl.amplitude.load(std::memory_order_relaxed);
+    int color = ctl.color.load(std::memory_order_relaxed);
+    ma_uint32 seed = ctl.seed.load(std::memory_order_relaxed);
+    const DecodedClip* clip = ctl.clip.load(std::memory_order_relaxed);
+    Reverb* reverb = ctl.reverb.load(std::memory_order_relaxed);
+    ma_int64 armedAtNs = ctl.armedAtNs.load(std::memory_order_relaxed);
+    ma_uint32 fadeInFrames = ctl.fadeInFrames.load(std::memory_order_relaxed);
+    ma_uint64 startCursor = ctl.startCursor.load(std::memory_order_relaxed);
+    bool unityGains = ctl.unityGains.load(std::memory_order_relaxed);
+    float gains[DSP_MAX_CHANNELS];
+    if (!unityGains) {
+        for (ma_uint32 c = 0; c < st->channels; ++c) gains[c] = ctl.gains[c].load(std::memory_order_relaxed);
+    }
+    int filterSections = ctl.filterSections.load(std::memory_order_relaxed);
+    dsp::BiquadCoeffs k[2];
+    for (int i = 0; i < filterSections; ++i) {
+        k[i].b0 = ctl.biquad[i][0].load(std::memory_order_relaxed);
+        k[i].b1 = ctl.biquad[i][1].load(std::memory_order_relaxed);
+        k[i].b2 = ctl.biquad[i][2].load(std::memory_order_relaxed);
+        k[i].a1 = ctl.biquad[i][3].load(std::memory_order_relaxed);
+        k[i].a2 = ctl.biquad[i][4].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (ctl.seq.load(std::memory_order_relaxed) != seq) return; // raced the writer; retry next block
+
+    st->seenSeq = seq;
+    st->armed = armed;
+    st->amplitude = amplitude;
+    st->clip = clip;
+    st->reverb = reverb && reverb->ready ? reverb : nullptr;
+    st->clipCursor = clip && startCursor < clip->frameCount ? startCursor : 0;
+    st->armedAtNs = armed ? armedAtNs : 0;
+    st->fadeGain = fadeInFrames ? 0.0f : 1.0f;
+    st->fadeStep = fadeInFrames ? 1.0f / (float)fadeInFrames : 0.0f;
+    st->fadingOut = false;
+    st->unityGains = unityGains;
+    if (!unityGains) memcpy(st->gains, gains, st->channels * sizeof(float));
+    st->filterSections = filterSections;
+    if (filterSections == 1) {
+        dsp::ChannelGains& cg = st->filtered.stage<1>();
+        if (unityGains) cg.set_unity();
+        else memcpy(cg.gains, gains, st->channels * sizeof(float));
+    } else if (filterSections == 2) {
+        dsp::ChannelGains& cg = st->steep.stage<2>();
+        if (unityGains) cg.set_unity();
+        else memcpy(cg.gains, gains, st->channels * sizeof(float));
+    }
+    if (armed) {
+        if (filterSections == 1) {
+            st->filtered.source.reset((DspNoiseColor)color, seed);
+            st->filtered.stage<0>().set(k[0]);
+        } else if (filterSections == 2) {
+            st->steep.source.reset((DspNoiseColor)color, seed);
+            st->steep.stage<0>().set(k[0]);
+            st->steep.stage<1>().set(k[1]);
+        } else {
+            dsp_noise_init(&st->noise, (DspNoiseColor)color, seed);
+        }
+    }
+    ctl.applied.store(seq, std::memory_order_release);
+}
+
+// Make writer the tap's only producer. Once this returns the previous owner's callback
+// has left loopback_write and will not enter it again.
+static void loopback_handoff(LoopbackTap* tap, const NoiseState* writer) {
+    if (!tap) return;
+    tap->owner.store(writer, std::memory_order_seq_cst);
+    while (tap->busy.load(std::memory_order_seq_cst)) std::this_thread::yield();
+}
+
+static void loopback_write_owned(LoopbackTap& tap, const float* samples, ma_uint32 frameCount, ma_uint32 channels, ma_uint32 sampleRate, bool armed) {
+    if (tap.resetRequested.exchange(false, std::memory_order_acquire)) loopback_clear(tap);
+    ma_int64 now = steady_now_ns();
+    ma_int64 last = tap.lastCallbackNs.exchange(now, std::memory_order_relaxed);
+    if (last && sampleRate) {
+        double intervalUs = (double)(now - last) / 1000.0;
+        double jitterUs = std::fabs(intervalUs - (double)frameCount * 1e6 / (double)sampleRate);
+        tap.intervals.store(tap.intervals.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        tap.intervalSumUs.store(tap.intervalSumUs.load(std::memory_order_relaxed) + intervalUs, std::memory_order_relaxed);
+        tap.jitterSumUs.store(tap.jitterSumUs.load(std::memory_order_relaxed) + jitterUs, std::memory_order_relaxed);
+        if (intervalUs > tap.intervalMaxUs.load(std::memory_order_relaxed)) tap.intervalMaxUs.store(intervalUs, std::memory_order_relaxed);
+        if (jitterUs > tap.jitterMaxUs.load(std::memory_order_relaxed)) tap.jitterMaxUs.store(jitterUs, std::memory_order_relaxed);
+    }
+    tap.callbacks.store(tap.callbacks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (!armed) return;
+
+    size_t n = (size_t)frameCount * channels;
+    DspLevels lv;
+    dsp_levels_f32(samples, n, &lv);
+    tap.channels.store(channels, std::memory_order_relaxed);
+    tap.sampleRate.store(sampleRate, std::memory_order_relaxed);
+    tap.frames.store(tap.frames.load(std::memory_order_relaxed) + frameCount, std::memory_order_relaxed);
+    tap.sumSquares.store(tap.sumSquares.load(std::memory_order_relaxed) + lv.sumSquares, std::memory_order_relaxed);
+    if (lv.peak > tap.peak.load(std::memory_order_relaxed)) tap.peak.store(lv.peak, std::memory_order_relaxed);
+
+    size_t pos = tap.captured.load(std::memory_order_relaxed);
+    if (pos >= LoopbackTap::kCapacitySamples) return;
+    size_t m = std::min(n, LoopbackTap::kCapacitySamples - pos);
+    for (size_t i = 0; i < m; ++i) tap.samples[pos + i].store(samples[i], std::memory_order_relaxed);
+    tap.captured.store(pos + m, std::memory_order_release);
+}
+
+static void loopback_write(LoopbackTap& tap, const NoiseState* writer, const float* samples, ma_uint32 frameCount, ma_uint32 channels, ma_uint32 sampleRate, bool armed) {
+    if (tap.owner.load(std::memory_order_relaxed) != writer) return;
+    // Pairs with loopback_handoff: either it sees busy, or this sees the new owner.
+    tap.busy.store(true, std::memory_order_seq_cst);
+    if (tap.owner.load(std::memory_order_seq_cst) == writer) loopback_write_owned(tap, samples, frameCount, channels, sampleRate, armed);
+    tap.busy.store(false, std::memory_order_release);
+}
+
+static void data_callback(ma_device* device, void* out, const void* in, ma_uint32 frameCount) {
+    NoiseState* st = (NoiseState*)device->pUserData;
+    apply_playback_control(st);
+    if (ma_uint32 fadeOut = st->control.fadeOutFrames.exchange(0, std::memory_order_relaxed)) {
+        st->fadeStep = -st->fadeGain / (float)fadeOut;
+        st->fadingOut = true;
+    }
+    float* f32 = (float*)out;
+    ma_uint64 total = (ma_uint64)frameCount * st->channels;
+    (void)in;
+    if (!st->armed) {
+        memset(f32, 0, (size_t)total * sizeof(float));
+        if (st->loopback) loopback_write(*st->loopback, st, f32, frameCount, st->channels, device->sampleRate, false);
+        return;
+    }
+    if (st->clip) {
+        const DecodedClip& clip = *st->clip;
+        ma_uint64 frames = clip.frameCount - st->clipCursor;
+        if (frames > frameCount) frames = frameCount;
+        const float* src = (const float*)clip.pcm.data() + st->clipCursor * clip.channels;
+        ma_uint64 n = frames * st->channels;
+        for (ma_uint64 i = 0; i < n; ++i) {
+            f32[i] = src[i] * st->amplitude;
+        }
+        for (ma_uint64 i = n; i < total; ++i) {
+            f32[i] = 0.0f;
+        }
+        if (!st->unityGains) dsp_channel_gains_f32(f32, (size_t)frames, st->channels, st->gains);
+        st->clipCursor += frames;
+        st->clipPosition.store(st->clipCursor, std::memory_order_relaxed);
+    } else if (st->filterSections == 1) {
+        st->filtered.render(f32, frameCount, st->channels, st->amplitude);
+    } else if (st->filterSections == 2) {
+        st->steep.render(f32, frameCount, st->channels, st->amplitude);
+    } else {
+        dsp_noise_render_f32(&st->noise, f32, frameCount, st->channels, st->amplitude, st->unityGains ? nullptr : st->gains);
+    }
+    if (st->reverb) dsp_convolver_process_f32(&st->reverb->cv, f32, frameCount, st->reverb->wet, st->reverb->dry);
+    if (st->fadeStep != 0.0f || st->fadeGain != 1.0f) {
+        float target = st->fadeStep > 0.0f ? 1.0f : 0.0f;
+        st->fadeGain = dsp_gain_ramp_f32(f32, frameCount, st->channels, st->fadeGain, st->fadeStep, target);
+        if (st->fadeGain == target) st->fadeStep = 0.0f;
+    }
+    // A device fading out after a switch no longer represents the session's output.
+    if (!st->fadingOut) loudness_push(*st->loudness, f32, frameCount, st->channels, device->sampleRate);
+    float normTarget = st->loudness->normalize.load(std::memory_order_relaxed) ? st->loudness->gain.load(std::memory_order_relaxed) : 1.0f;
+    if (normTarget != st->normTarget) {
+        st->normTarget = normTarget;
+        st->normStep = (normTarget - st->normGain) / (kNormalizeRampSeconds * (float)device->sampleRate);
+    }
+    if (st->normGain != 1.0f || st->normStep != 0.0f) {
+        st->normGain = dsp_gain_ramp_f32(f32, frameCount, st->channels, st->normGain, st->normStep, st->normTarget);
+        if (st->normGain == st->normTarget) st->normStep = 0.0f;
+    }
+    LimiterControl& lc = *st->limiterControl;
+    if (st->limiterReady && lc.enabled.load(std::memory_order_relaxed)) {
+        if (!st->limiterActive) {
+            dsp_limiter_reset(&st->limiter);
+            st->limiterActive = true;
+        }
+        dsp_limiter_set_ceiling(&st->limiter, lc.ceiling.load(std::memory_order_relaxed));
+        float minGain = dsp_limiter_process_f32(&st->limiter, f32, frameCount);
+        if (!st->fadingOut) limiter_meter(lc, minGain);
+    } else {
+        st->limiterActive = false;
+    }
+    if (st->armedAtNs) {
+        for (ma_uint64 i = 0; i < total; ++i) {
+            if (f32[i] != 0.0f) {
+                record_start_latency(*st->latency, st->armedAtNs);
+                st->armedAtNs = 0;
+                break;
+            }
+        }
+    }
+    if (st->loopback) loopback_write(*st->loopback, st, f32, frameCount, st->channels, device->sampleRate, true);
+}
+
+// Optional speaker positions and per-channel gains for one output.
+struct ChannelLayout {
+    std::vector<ma_channel> map; // one position per channel; empty uses miniaudio's default
+    std::vector<float> gains;    // one linear gain per channel (0 mutes); empty is unity
+};
+
+struct OutputKey {
+    bool hasId;
+    ma_device_id id;
+    ma_format format;
+    ma_uint32 channels;
+    ma_uint32 rate;
+    std::vector<ma_channel> channelMap;
+};
+
+static bool same_output_key(const OutputKey& a, const OutputKey& b) {
+    if (a.hasId != b.hasId || a.format != b.format || a.channels != b.channels || a.rate != b.rate) return false;
+    if (a.channelMap != b.channelMap) return false;
+    return !a.hasId || memcmp(&a.id, &b.id, sizeof(ma_device_id)) == 0;
+}
+
+// Seed used when a request does not name one, so repeated requests render identically.
+static const ma_uint32 kDefaultNoiseSeed = 1234567u;
+
+enum class FilterType { None, Lowpass, Highpass, Bandpass };
+
+// Optional filter on generated noise. steep cascades two sections (24 dB/octave); for
+// low/highpass the sections take Butterworth Qs and q is ignored.
+struct NoiseFilter {
+    FilterType type = FilterType::None;
+    float hz = 1000.0f;
+    float q = 0.7071f;
+    bool steep = false;
+};
+
+static const char* filter_type_name(FilterType t) {
+    switch (t) {
+    case FilterType::Lowpass: return "lowpass";
+    case FilterType::Highpass: return "highpass";
+    case FilterType::Bandpass: return "bandpass";
+    default: return "none";
+    }
+}
+
+static bool filter_type_from_name(const char* name, FilterType* out) {
+    const FilterType types[] = {FilterType::None, FilterType::Lowpass, FilterType::Highpass, FilterType::Bandpass};
+    for (FilterType t : types) {
+        if (strcmp(name, filter_type_name(t)) == 0) {
+            *out = t;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Design the biquad sections for f at rate. Returns how many are used (0-2).
+static int filter_sections(const NoiseFilter& f, ma_uint32 rate, dsp::BiquadCoeffs* k) {
+    if (f.type == FilterType::None) return 0;
+    float hz = std::min(std::max(f.hz, 10.0f), 0.45f * (float)rate);
+    const float butterworthQ[2] = {0.5412f, 1.3066f};
+    int sections = f.steep ? 2 : 1;
+    for (int i = 0; i < sections; ++i) {
+        float q = f.steep ? butterworthQ[i] : f.q;
+        if (f.type == FilterType::Lowpass) k[i] = dsp::BiquadCoeffs::lowpass((float)rate, hz, q);
+        else if (f.type == FilterType::Highpass) k[i] = dsp::BiquadCoeffs::highpass((float)rate, hz, q);
+        else k[i] = dsp::BiquadCoeffs::bandpass((float)rate, hz, f.q);
+    }
+    return sections;
+}
+
+// Convolution reverb for a playback; each device builds its own Reverb from it.
+struct ReverbSpec {
+    std::shared_ptr<const ConvolutionIr> ir; // null for none
+    float wet = 0.3f;
+    float dry = 1.0f;
+};
+
+struct PlaybackParams {
+    bool armed;
+    float amplitude;
+    DspNoiseColor color;
+    ma_uint32 seed;
+    std::shared_ptr<const DecodedClip> clip;
+    ma_int64 armedAtNs;
+    ma_uint32 fadeInFrames = 0;
+    ma_uint64 startCursor = 0;
+    std::vector<float> gains; // empty for unity
+    NoiseFilter filter;
+    ReverbSpec reverb;
+};
+
+// Persistent playback device; the callback's state lives next to it so pUserData stays valid.
+struct OutputDevice {
+    ma_device device;
+    OutputKey key;
+    NoiseState state;
+    bool running = false;
+    bool armed = false;
+    PlaybackParams params{}; // last published, clip held separately below
+    // The clip and reverb referenced by the published control block, plus replaced ones
+    // the callback may still be using until it applies the tagged sequence number.
+    std::shared_ptr<const DecodedClip> clip;
+    std::shared_ptr<Reverb> reverb;
+    std::vector<std::pair<ma_uint32, std::shared_ptr<const void>>> retired;
+};
+
+static void publish_playback_locked(OutputDevice& out, PlaybackParams params) {
+    PlaybackControl& ctl = out.state.control;
+    ma_uint32 seq = ctl.seq.load(std::memory_order_relaxed);
+    ctl.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    ctl.armed.store(params.armed, std::memory_order_relaxed);
+    ctl.amplitude.store(params.amplitude, std::memory_order_relaxed);
+    ctl.color.store((int)params.color, std::memory_order_relaxed);
+    ctl.seed.store(params.seed, std::memory_order_relaxed);
+    ctl.clip.store(params.clip.get(), std::memory_order_relaxed);
+    std::shared_ptr<Reverb> reverb;
+    if (params.armed && params.reverb.ir) {
+        reverb = std::make_shared<Reverb>(params.reverb.ir, out.key.channels, params.reverb.wet, params.reverb.dry);
+    }
+    ctl.reverb.store(reverb.get(), std::memory_order_relaxed);
+    ctl.armedAtNs.store(params.armedAtNs, std::memory_order_relaxed);
+    ctl.fadeInFrames.store(params.fadeInFrames, std::memory_order_relaxed);
+    ctl.startCursor.store(params.startCursor, std::memory_order_relaxed);
+    ctl.unityGains.store(params.gains.empty(), std::memory_order_relaxed);
+    for (size_t c = 0; c < params.gains.size() && c < DSP_MAX_CHANNELS; ++c) {
+        ctl.gains[c].store(params.gains[c], std::memory_order_relaxed);
+    }
+    dsp::BiquadCoeffs k[2];
+    int sections = params.clip ? 0 : filter_sections(params.filter, out.key.rate, k);
+    ctl.filterSections.store(sections, std::memory_order_relaxed);
+    for (int i = 0; i < sections; ++i) {
+        ctl.biquad[i][0].store(k[i].b0, std::memory_order_relaxed);
+        ctl.biquad[i][1].store(k[i].b1, std::memory_order_relaxed);
+        ctl.biquad[i][2].store(k[i].b2, std::memory_order_relaxed);
+        ctl.biquad[i][3].store(k[i].a1, std::memory_order_relaxed);
+        ctl.biquad[i][4].store(k[i].a2, std::memory_order_relaxed);
+    }
+    ctl.seq.store(seq + 2, std::memory_order_release);
+    out.armed = params.armed;
+    out.params = params;
+    out.params.clip = nullptr;
+
+    if (out.clip != params.clip) {
+        if (out.clip) out.retired.emplace_back(seq + 2, std::move(out.clip));
+        out.clip = std::move(params.clip);
+    }
+    if (out.reverb) out.retired.emplace_back(seq + 2, std::move(out.reverb));
+    out.reverb = std::move(reverb);
+    ma_uint32 applied = ctl.applied.load(std::memory_order_acquire);
+    auto& retired = out.retired;
+    retired.erase(std::remove_if(retired.begin(), retired.end(), [&](const std::pair<ma_uint32, std::shared_ptr<const void>>& r) {
+        return !out.running || (ma_int32)(applied - r.first) >= 0;
+    }), retired.end());
+}
+
+// Deadline timers served by one thread that sleeps until the earliest due time and
+// blocks indefinitely while nothing is scheduled. Cancelled entries are dropped lazily.
+struct TimerQueue {
+    using Clock = std::chrono::steady_clock;
+    struct Timer {
+        Clock::time_point due;
+        ma_uint64 id;
+        std::function<void()> fn;
+    };
+    struct Later {
+        bool operator()(const Timer& a, const Timer& b) const { return a.due > b.due; }
+    };
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::priority_queue<Timer, std::vector<Timer>, Later> heap;
+    std::unordered_set<ma_uint64> pending;
+    ma_uint64 nextId = 1;
+    bool stop = false;
+    std::thread thread;
+};
+
+static TimerQueue g_timers;
+
+static void timer_thread(TimerQueue* q) {
+    std::unique_lock<std::mutex> lock(q->mutex);
+    while (!q->stop) {
+        if (q->heap.empty()) {
+            q->wake.wait(lock);
+            continue;
+        }
+        if (TimerQueue::Clock::now() < q->heap.top().due) {
+            q->wake.wait_until(lock, q->heap.top().due);
+            continue;
+        }
+        TimerQueue::Timer t = q->heap.top();
+        q->heap.pop();
+        if (q->pending.erase(t.id) == 0) continue; // cancelled
+        lock.unlock();
+        t.fn();
+        lock.lock();
+    }
+}
+
+// Run fn on the timer thread at due. Returns an id for timer_cancel.
+static ma_uint64 timer_schedule(TimerQueue& q, TimerQueue::Clock::time_point due, std::function<void()> fn) {
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (!q.thread.joinable()) {
+        q.thread = std::thread(timer_thread, &q);
+    }
+    ma_uint64 id = q.nextId++;
+    bool earliest = q.heap.empty() || due < q.heap.top().due;
+    q.heap.push(TimerQueue::Timer{due, id, std::move(fn)});
+    q.pending.insert(id);
+    if (earliest) q.wake.notify_one();
+    return id;
+}
+
+static void timer_cancel(TimerQueue& q, ma_uint64 id) {
+    std::lock_guard<std::mutex> lock(q.mutex);
+    q.pending.erase(id);
+    // Rebuild once cancelled entries dominate so rescheduling cannot grow the heap unbounded.
+    if (q.heap.size() > 64 && q.heap.size() > 2 * q.pending.size()) {
+        std::vector<TimerQueue::Timer> live;
+        while (!q.heap.empty()) {
+            if (q.pending.count(q.heap.top().id)) live.push_back(q.heap.top());
+            q.heap.pop();
+        }
+        for (auto& t : live) q.heap.push(std::move(t));
+        q.wake.notify_one();
+    }
+}
+
+static void timer_queue_stop(TimerQueue& q) {
+    {
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.stop = true;
+    }
+    q.wake.notify_one();
+    if (q.thread.joinable()) q.thread.join();
+}
+
+// One playback zone: its own selected device, generator state, timers and lock, so
+// sessions driving different speakers never wait on each other. The existing /audio
+// endpoints operate on the "default" session.
+struct PlaybackSession {
+    std::string id;
+    std::mutex mutex; // guards everything below
+    DeviceSelection device;
+    std::unique_ptr<OutputDevice> output;
+    // Previous device during a crossfaded switch, released by a timer once silent.
+    std::unique_ptr<OutputDevice> fadingOutput;
+    ma_uint64 fadeTimer = 0;
+    // Deadline of the current playback; the generation guards against a timer that fired
+    // while a newer playback was being started.
+    ma_uint64 noiseTimer = 0;
+    ma_uint64 generation = 0;
+    ma_uint64 outputInits = 0;
+    ma_uint64 outputReuses = 0;
+    // In standby the device keeps running and outputs silence between requests.
+    bool standby = false;
+    bool closed = false; // removed from the table; nothing may reopen the device
+    StartLatency latency;
+    std::unique_ptr<LoopbackTap> loopback; // benchmark mode only
+    std::unique_ptr<LoudnessMeter> loudness{new LoudnessMeter()};
+    LimiterControl limiter;
+};
+
+static std::shared_ptr<PlaybackSession> make_session(const std::string& id) {
+    auto s = std::make_shared<PlaybackSession>();
+    s->id = id;
+    if (g_loopbackEnabled) s->loopback = std::make_unique<LoopbackTap>();
+    return s;
+}
+
+static const char* kDefaultSessionId = "default";
+static const size_t kMaxSessions = 16;
+
+static std::mutex g_sessionsMutex; // guards the table only, never held while touching a device
+static std::unordered_map<std::string, std::shared_ptr<PlaybackSession>> g_sessions;
+static ma_uint64 g_nextSessionNumber = 1;
+
+static bool valid_session_id(const std::string& id) {
+    if (id.empty() || id.size() > 32) return false;
+    for (char c : id) {
+        if (!isalnum((unsigned char)c) && c != '-' && c != '_') return false;
+    }
+    return true;
+}
+
+static std::shared_ptr<PlaybackSession> find_session(const std::string& id) {
+    std::lock_guard<std::mutex> lock(g_sessionsMutex);
+    auto it = g_sessions.find(id);
+    return it != g_sessions.end() ? it->second : nullptr;
+}
+
+static std::shared_ptr<PlaybackSession> default_session() {
+    std::lock_guard<std::mutex> lock(g_sessionsMutex);
+    std::shared_ptr<PlaybackSession>& s = g_sessions[kDefaultSessionId];
+    if (!s) s = make_session(kDefaultSessionId);
+    return s;
+}
+
+// Create a session; an empty id picks "zone-N". Returns null if the id is taken or
+// the table is full.
+static std::shared_ptr<PlaybackSession> create_session(std::string id) {
+    std::lock_guard<std::mutex> lock(g_sessionsMutex);
+    if (g_sessions.size() >= kMaxSessions) return nullptr;
+    if (id.empty()) {
+        do {
+            id = "zone-" + std::to_string(g_nextSessionNumber++);
+        } while (g_sessions.count(id));
+    }
+    if (g_sessions.count(id)) return nullptr;
+    auto s = make_session(id);
+    g_sessions[id] = s;
+    return s;
+}
+
+static std::vector<std::shared_ptr<PlaybackSession>> list_sessions() {
+    std::vector<std::shared_ptr<PlaybackSession>> out;
+    std::lock_guard<std::mutex> lock(g_sessionsMutex);
+    for (auto& kv : g_sessions) out.push_back(kv.second);
+    std::sort(out.begin(), out.end(), [](const std::shared_ptr<PlaybackSession>& a, const std::shared_ptr<PlaybackSession>& b) {
+        return a->id < b->id;
+    });
+    return out;
+}
+
+// Stop and start playback devices through these so the stopped notification can tell
+// the server's own stops from a device disappearing.
+static void stop_output_device(OutputDevice& out) {
+    out.state.stopping.store(true, std::memory_order_release);
+    ma_device_stop(&out.device);
+    out.running = false;
+}
+
+static bool start_output_device(OutputDevice& out) {
+    out.state.stopping.store(false, std::memory_order_release);
+    loopback_handoff(out.state.loopback, &out.state);
+    if (ma_device_start(&out.device) != MA_SUCCESS) return false;
+    out.running = true;
+    return true;
+}
+
+static void release_output(std::unique_ptr<OutputDevice>& out) {
+    if (!out) return;
+    if (out->running) stop_output_device(*out);
+    ma_device_uninit(&out->device);
+    if (out->state.limiterReady) dsp_limiter_free(&out->state.limiter);
+    out.reset();
+}
+
+static void release_fading_output_locked(PlaybackSession& s) {
+    if (s.fadeTimer) {
+        timer_cancel(g_timers, s.fadeTimer);
+        s.fadeTimer = 0;
+    }
+    release_output(s.fadingOutput);
+}
+
+// Silence the current playback: disarm in standby, otherwise stop the device.
+static void stop_noise_locked(PlaybackSession& s) {
+    if (s.noiseTimer) {
+        timer_cancel(g_timers, s.noiseTimer);
+        s.noiseTimer = 0;
+    }
+    if (!s.output) return;
+    if (s.output->running && !s.standby) stop_output_device(*s.output);
+    publish_playback_locked(*s.output, PlaybackParams{false, 0.0f, DSP_NOISE_WHITE, 0, nullptr, 0, 0, 0, {}, {}, {}});
+}
+
+static void close_output_locked(PlaybackSession& s) {
+    stop_noise_locked(s);
+    release_output(s.output);
+}
+
+static OutputKey make_output_key_locked(PlaybackSession& s, ma_uint32 rate, ma_uint32 channels, const std::vector<ma_channel>& channelMap) {
+    OutputKey key{};
+    key.format = ma_format_f32;
+    key.channels = channels;
+    key.rate = rate;
+    key.channelMap = channelMap;
+    auto snap = device_snapshot();
+    key.hasId = resolve_selection(s.device, snap ? &snap->playbackByKey : nullptr, &key.id);
+    return key;
+}
+
+// BS.1770 channel weights from the output's channel map: LFE is excluded and surround
+// channels count 1.41.
+static void set_loudness_weights(LoudnessMeter& m, const OutputKey& key) {
+    ma_channel map[DSP_MAX_CHANNELS];
+    if (key.channelMap.empty()) {
+        ma_channel_map_init_standard(ma_standard_channel_map_default, map, DSP_MAX_CHANNELS, key.channels);
+    } else {
+        std::copy(key.channelMap.begin(), key.channelMap.end(), map);
+    }
+    for (ma_uint32 c = 0; c < key.channels && c < DSP_LOUDNESS_MAX_CHANNELS; ++c) {
+        float w = 1.0f;
+        switch (map[c]) {
+        case MA_CHANNEL_LFE: w = 0.0f; break;
+        case MA_CHANNEL_BACK_LEFT:
+        case MA_CHANNEL_BACK_RIGHT:
+        case MA_CHANNEL_BACK_CENTER:
+        case MA_CHANNEL_SIDE_LEFT:
+        case MA_CHANNEL_SIDE_RIGHT: w = 1.41f; break;
+        default: break;
+        }
+        m.weights[c].store(w, std::memory_order_relaxed);
+    }
+    m.weightsVersion.fetch_add(1, std::memory_order_release);
+}
+
+// Make s.output match key, reusing the initialized device when the config is unchanged.
+static bool open_output_locked(PlaybackSession& s, const OutputKey& key) {
+    if (s.output && !same_output_key(s.output->key, key)) {
+        close_output_locked(s);
+    }
+    if (s.output) {
+        s.outputReuses++;
+        return true;
+    }
+    auto output = std::make_unique<OutputDevice>();
+    output->state.channels = key.channels;
+    output->state.latency = &s.latency;
+    output->state.loopback = s.loopback.get();
+    output->state.loudness = s.loudness.get();
+    output->state.limiterControl = &s.limiter;
+    // Continue at the session's current normalization gain rather than ramping from unity.
+    output->state.normGain = s.loudness->normalize.load(std::memory_order_relaxed) ? s.loudness->gain.load(std::memory_order_relaxed) : 1.0f;
+    output->state.normTarget = output->state.normGain;
+    set_loudness_weights(*s.loudness, key);
+    ma_device_config config = ma_device_config_init(ma_device_type_playback);
+    config.playback.format = key.format;
+    config.playback.channels = key.channels;
+    config.playback.pChannelMap = key.channelMap.empty() ? nullptr : const_cast<ma_channel*>(key.channelMap.data());
+    config.playback.pDeviceID = key.hasId ? &key.id : nullptr;
+    config.sampleRate = key.rate;
+    config.dataCallback = data_callback;
+    config.notificationCallback = device_notification_callback;
+    config.pUserData = &output->state;
+    if (ma_device_init(&g_ctx, &config, &output->device) != MA_SUCCESS) {
+        return false;
+    }
+    output->state.limiterReady = dsp_limiter_init(&output->state.limiter, output->device.sampleRate, key.channels, kLimiterLookaheadMs, kLimiterReleaseMs, s.limiter.ceiling.load(std::memory_order_relaxed)) == 0;
+    output->key = key;
+    s.output = std::move(output);
+    s.outputInits++;
+    return true;
+}
+
+static bool start_output_locked(PlaybackSession& s) {
+    if (s.output->running) return true;
+    if (!start_output_device(*s.output)) {
+        close_output_locked(s);
+        return false;
+    }
+    return true;
+}
+
+// Start the session's playback device with either generated noise or a decoded clip.
+// A running device with a matching config is re-armed in place through the control block.
+static bool start_playback(const std::shared_ptr<PlaybackSession>& session, ma_uint32 rate, ma_uint32 channels, const ChannelLayout& layout, float amp, DspNoiseColor color, ma_uint32 seed, const NoiseFilter& filter, const ReverbSpec& reverb, ma_uint32 duration_ms, std::shared_ptr<const DecodedClip> clip) {
+    ma_int64 requestedAtNs = steady_now_ns();
+    if (!ensure_audio_context()) return false;
+    PlaybackSession& s = *session;
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (s.closed) return false;
+
+    if (s.noiseTimer) {
+        timer_cancel(g_timers, s.noiseTimer);
+        s.noiseTimer = 0;
+    }
+    ma_uint64 generation = ++s.generation;
+
+    if (!open_output_locked(s, make_output_key_locked(s, rate, channels, layout.map))) return false;
+    PlaybackParams params{true, amp, color, seed, std::move(clip), requestedAtNs, 0, 0, layout.gains, filter, reverb};
+    publish_playback_locked(*s.output, std::move(params));
+    s.loudness->resetRequested.store(true, std::memory_order_release);
+    if (!start_output_locked(s)) return false;
+
+    if (duration_ms > 0) {
+        std::weak_ptr<PlaybackSession> weak = session;
+        s.noiseTimer = timer_schedule(g_timers, std::chrono::steady_clock::now() + std::chrono::milliseconds(duration_ms), [weak, generation]() {
+            auto s = weak.lock();
+            if (!s) return;
+            std::lock_guard<std::mutex> lock(s->mutex);
+            if (s->generation != generation) return;
+            s->noiseTimer = 0;
+            stop_noise_locked(*s);
+        });
+    }
+    return true;
+}
+
+// Keep the selected device open and running (silent) so playback starts by arming only.
+static bool set_standby(PlaybackSession& s, bool enabled, ma_uint32 rate, ma_uint32 channels, const std::vector<ma_channel>& channelMap) {
+    if (!ensure_audio_context()) return false;
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (s.closed) return false;
+    s.standby = enabled;
+    if (!enabled) {
+        if (s.output && s.output->running && !s.output->armed) stop_output_device(*s.output);
+        return true;
+    }
+    if (s.output && s.output->armed) {
+        return true; // keep the current playback; the device stays up once it ends
+    }
+    if (!open_output_locked(s, make_output_key_locked(s, rate, channels, channelMap))) return false;
+    return start_output_locked(s);
+}
+
+static const ma_uint32 kDefaultCrossfadeMs = 50;
+// Extra time before releasing the old device so its buffered, faded audio drains.
+static const ma_uint32 kCrossfadeDrainMs = 100;
+
+// Select a session's playback device. While something is playing, open the new device
+// with the same format, hand over the source (params and clip position), fade it in
+// while the old device fades out, then release the old device from a timer.
+static bool select_playback_device(const std::shared_ptr<PlaybackSession>& session, const DeviceSelection& sel, ma_uint32 crossfadeMs) {
+    bool ctxReady = ensure_audio_context();
+    PlaybackSession& s = *session;
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.device = sel;
+    if (!ctxReady || s.closed || !s.output || !s.output->running) return true;
+
+    OutputKey key = make_output_key_locked(s, s.output->key.rate, s.output->key.channels, s.output->key.channelMap);
+    if (same_output_key(s.output->key, key)) return true;
+
+    if (!s.output->armed) {
+        // Standby with nothing playing: move the silent device over directly.
+        close_output_locked(s);
+        if (!open_output_locked(s, key)) return false;
+        return start_output_locked(s);
+    }
+
+    release_fading_output_locked(s);
+    std::unique_ptr<OutputDevice> old = std::move(s.output);
+    if (!open_output_locked(s, key)) {
+        s.output = std::move(old);
+        return false;
+    }
+    ma_uint32 fadeFrames = (ma_uint32)((ma_uint64)key.rate * crossfadeMs / 1000);
+    PlaybackParams params = old->params;
+    params.clip = old->clip;
+    params.armedAtNs = 0;
+    params.fadeInFrames = fadeFrames;
+    params.startCursor = old->state.clipPosition.load(std::memory_order_relaxed);
+    publish_playback_locked(*s.output, params);
+    // Fade the old device out before the new one starts so the two never both feed
+    // the session's meters.
+    old->state.control.fadeOutFrames.store(fadeFrames ? fadeFrames : 1, std::memory_order_relaxed);
+    if (!start_output_device(*s.output)) {
+        release_output(s.output);
+        s.output = std::move(old);
+        loopback_handoff(s.output->state.loopback, &s.output->state);
+        if (s.output->state.control.fadeOutFrames.exchange(0, std::memory_order_relaxed) == 0) {
+            // The fade-out already began; bring the source back in from where it is.
+            PlaybackParams back = s.output->params;
+            back.clip = s.output->clip;
+            back.armedAtNs = 0;
+            back.fadeInFrames = fadeFrames;
+            back.startCursor = s.output->state.clipPosition.load(std::memory_order_relaxed);
+            publish_playback_locked(*s.output, back);
+        }
+        return false;
+    }
+    s.fadingOutput = std::move(old);
+    std::weak_ptr<PlaybackSession> weak = session;
+    s.fadeTimer = timer_schedule(g_timers, std::chrono::steady_clock::now() + std::chrono::milliseconds(crossfadeMs + kCrossfadeDrainMs), [weak]() {
+        auto s = weak.lock();
+        if (!s) return;
+        std::lock_guard<std::mutex> lock(s->mutex);
+        s->fadeTimer = 0;
+        release_output(s->fadingOutput);
+    });
+    return true;
+}
+
+static bool start_noise(const std::shared_ptr<PlaybackSession>& session, ma_uint32 rate, ma_uint32 channels, const ChannelLayout& layout, float amp, DspNoiseColor color, ma_uint32 seed, const NoiseFilter& filter, const ReverbSpec& reverb, ma_uint32 duration_ms) {
+    return start_playback(session, rate, channels, layout, amp, color, seed, filter, reverb, duration_ms, nullptr);
+}
+
+static void stop_noise(PlaybackSession& s) {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    stop_noise_locked(s);
+}
+
+// Release the session's devices and mark it closed so pending timers become no-ops.
+static void close_session(PlaybackSession& s) {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.closed = true;
+    release_fading_output_locked(s);
+    close_output_locked(s);
+}
+
+static bool remove_session(const std::string& id) {
+    std::shared_ptr<PlaybackSession> s;
+    {
+        std::lock_guard<std::mutex> lock(g_sessionsMutex);
+        auto it = g_sessions.find(id);
+        if (it == g_sessions.end()) return false;
+        s = std::move(it->second);
+        g_sessions.erase(it);
+    }
+    close_session(*s);
+    return true;
+}
+
+// Start a fresh loopback measurement. While a device runs the callback clears the tap
+// at the start of its next block; otherwise nothing writes it and it is cleared here.
+static bool reset_loopback(PlaybackSession& s) {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (!s.loopback) return false;
+    bool running = (s.output && s.output->running) || (s.fadingOutput && s.fadingOutput->running);
+    if (running) {
+        s.loopback->resetRequested.store(true, std::memory_order_release);
+    } else {
+        s.loopback->resetRequested.store(false, std::memory_order_relaxed);
+        loopback_clear(*s.loopback);
+    }
+    return true;
+}
+
+// Loopback counters as JSON. The hash covers the first hashFrames captured frames (all
+// captured frames when 0), so runs of different length can be compared bit for bit.
+static std::string render_loopback_json(PlaybackSession& s, size_t hashFrames) {
+    cJSON* root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "session", s.id.c_str());
+    LoopbackTap* tap = s.loopback.get();
+    cJSON_AddBoolToObject(root, "enabled", tap != nullptr);
+    if (tap) {
+        ma_uint32 channels = tap->channels.load(std::memory_order_relaxed);
+        ma_uint64 frames = tap->frames.load(std::memory_order_relaxed);
+        size_t captured = tap->captured.load(std::memory_order_acquire);
+        size_t hashSamples = hashFrames && channels ? std::min(captured, hashFrames * channels) : captured;
+        std::vector<float> copy(hashSamples);
+        for (size_t i = 0; i < hashSamples; ++i) copy[i] = tap->samples[i].load(std::memory_order_relaxed);
+        char hash[17];
+        snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)dsp_fnv1a64(DSP_FNV1A64_INIT, copy.data(), copy.size() * sizeof(float)));
+        ma_uint64 intervals = tap->intervals.load(std::memory_order_relaxed);
+        double sumSquares = tap->sumSquares.load(std::memory_order_relaxed);
+
+        cJSON_AddNumberToObject(root, "channels", channels);
+        cJSON_AddNumberToObject(root, "sample_rate", tap->sampleRate.load(std::memory_order_relaxed));
+        cJSON_AddNumberToObject(root, "callbacks", (double)tap->callbacks.load(std::memory_order_relaxed));
+        cJSON_AddNumberToObject(root, "frames", (double)frames);
+        cJSON_AddNumberToObject(root, "captured_frames", channels ? (double)(captured / channels) : 0.0);
+        cJSON_AddNumberToObject(root, "hashed_frames", channels ? (double)(hashSamples / channels) : 0.0);
+        cJSON_AddStringToObject(root, "hash", hash);
+        cJSON_AddNumberToObject(root, "peak", tap->peak.load(std::memory_order_relaxed));
+        cJSON_AddNumberToObject(root, "rms", frames && channels ? std::sqrt(sumSquares / (double)(frames * channels)) : 0.0);
+        cJSON* jint = cJSON_AddObjectToObject(root, "callback_interval_us");
+        cJSON_AddNumberToObject(jint, "count", (double)intervals);
+        cJSON_AddNumberToObject(jint, "mean", intervals ? tap->intervalSumUs.load(std::memory_order_relaxed) / (double)intervals : 0.0);
+        cJSON_AddNumberToObject(jint, "max", tap->intervalMaxUs.load(std::memory_order_relaxed));
+        cJSON_AddNumberToObject(jint, "jitter_mean", intervals ? tap->jitterSumUs.load(std::memory_order_relaxed) / (double)intervals : 0.0);
+        cJSON_AddNumberToObject(jint, "jitter_max", tap->jitterMaxUs.load(std::memory_order_relaxed));
+    }
+    char* text = cJSON_PrintUnformatted(root);
+    std::string json = text ? text : "{}";
+    cJSON_free(text);
+    cJSON_Delete(root);
+    return json;
+}
+
+// One thread meters every session every 100 ms, the BS.1770 sub-block step.
+struct LoudnessWorker {
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stop = false;
+    std::thread thread;
+};
+
+static LoudnessWorker g_loudnessWorker;
+
+static void loudness_update(LoudnessMeter& m) {
+    ma_uint32 channels = m.channels.load(std::memory_order_acquire);
+    ma_uint64 layoutStart = m.layoutStart.load(std::memory_order_relaxed);
+    ma_uint64 w = m.written.load(std::memory_order_acquire);
+    // The layout changed between the loads; pick it up on the next pass.
+    if (m.channels.load(std::memory_order_acquire) != channels) return;
+    ma_uint32 rate = m.sampleRate.load(std::memory_order_relaxed);
+    ma_uint32 version = m.weightsVersion.load(std::memory_order_acquire);
+    if (channels == 0 || rate == 0) return;
+    bool reset = m.resetRequested.exchange(false, std::memory_order_acq_rel);
+    if (channels != m.meterChannels || rate != m.meterRate || version != m.meterVersion) {
+        float weights[DSP_LOUDNESS_MAX_CHANNELS];
+        for (ma_uint32 c = 0; c < channels; ++c) weights[c] = m.weights[c].load(std::memory_order_relaxed);
+        dsp_loudness_init(&m.meter, rate, channels, weights);
+        m.meterChannels = channels;
+        m.meterRate = rate;
+        m.meterVersion = version;
+        reset = true;
+    } else if (reset) {
+        dsp_loudness_reset(&m.meter);
+    }
+    // Frame boundaries are counted from where the current layout started, not from zero.
+    if (reset) m.readPos = w - ((w - layoutStart) % channels);
+    if (w - m.readPos > LoudnessMeter::kRingSamples) {
+        // Fell behind the callback; resume at the oldest complete frame still in the ring.
+        ma_uint64 skip = w - LoudnessMeter::kRingSamples - m.readPos;
+        skip += (channels - skip % channels) % channels;
+        m.droppedSamples.fetch_add(skip, std::memory_order_relaxed);
+        m.readPos += skip;
+    }
+
+    float block[1024];
+    const size_t mask = LoudnessMeter::kRingSamples - 1;
+    const size_t blockFrames = sizeof(block) / sizeof(block[0]) / channels;
+    while (w - m.readPos >= channels) {
+        size_t frames = std::min<size_t>(blockFrames, (size_t)((w - m.readPos) / channels));
+        for (size_t i = 0; i < frames * channels; ++i) block[i] = m.ring[(m.readPos + i) & mask].load(std::memory_order_relaxed);
+        dsp_loudness_add_f32(&m.meter, block, frames);
+        m.readPos += frames * channels;
+    }
+
+    double shortTerm = dsp_loudness_short_term(&m.meter);
+    m.momentary.store(dsp_loudness_momentary(&m.meter), std::memory_order_relaxed);
+    m.shortTerm.store(shortTerm, std::memory_order_relaxed);
+    m.integrated.store(dsp_loudness_integrated(&m.meter), std::memory_order_relaxed);
+    // Short-term loudness is measured before normalization, so the gain does not feed
+    // back into its own measurement. Hold the current gain until 400 ms of signal exist.
+    if (m.meter.subBlockCount >= 4 && shortTerm > DSP_LOUDNESS_FLOOR) {
+        float db = m.targetLufs.load(std::memory_order_relaxed) - (float)shortTerm;
+        db = std::min(std::max(db, kNormalizeMinGainDb), kNormalizeMaxGainDb);
+        m.gain.store(std::pow(10.0f, db / 20.0f), std::memory_order_relaxed);
+    }
+}
+
+static void loudness_worker() {
+    std::unique_lock<std::mutex> lock(g_loudnessWorker.mutex);
+    while (!g_loudnessWorker.stop) {
+        if (g_loudnessWorker.wake.wait_for(lock, std::chrono::milliseconds(100), []() { return g_loudnessWorker.stop; })) break;
+        lock.unlock();
+        for (auto& s : list_sessions()) loudness_update(*s->loudness);
+        lock.lock();
+    }
+}
+
+static void loudness_worker_start() {
+    g_loudnessWorker.thread = std::thread(loudness_worker);
+}
+
+static void loudness_worker_stop() {
+    {
+        std::lock_guard<std::mutex> lock(g_loudnessWorker.mutex);
+        g_loudnessWorker.stop = true;
+    }
+    g_loudnessWorker.wake.notify_all();
+    if (g_loudnessWorker.thread.joinable()) g_loudnessWorker.thread.join();
+}
+
+// Turn normalization to targetLufs on, or off when target is null.
+static void set_loudness_target(PlaybackSession& s, bool enabled, float targetLufs) {
+    LoudnessMeter& m = *s.loudness;
+    m.targetLufs.store(targetLufs, std::memory_order_relaxed);
+    m.normalize.store(enabled, std::memory_order_relaxed);
+}
+
+static void load_device_selection() {
+    FILE* f = fopen(kDeviceStateFile, "rb");
+    if (!f) return;
+    std::string text;
+    char buf[512];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+    fclose(f);
+    cJSON* root = cJSON_Parse(text.c_str());
+    if (!root) return;
+    cJSON* jplay = cJSON_GetObjectItemCaseSensitive(root, "playback");
+    cJSON* jcap = cJSON_GetObjectItemCaseSensitive(root, "capture");
+    if (cJSON_IsString(jplay)) {
+        auto s = default_session();
+        std::lock_guard<std::mutex> lock(s->mutex);
+        if (device_id_from_key(jplay->valuestring, &s->device.id)) s->device.key = jplay->valuestring;
+    }
+    if (cJSON_IsString(jcap)) {
+        std::lock_guard<std::mutex> lock(g_audioMutex);
+        if (device_id_from_key(jcap->valuestring, &g_selectedCapture.id)) g_selectedCapture.key = jcap->valuestring;
+    }
+    cJSON_Delete(root);
+}
+
+// Persist the default session's and the capture selection.
+static void save_device_selection() {
+    cJSON* root = cJSON_CreateObject();
+    {
+        auto s = default_session();
+        std::lock_guard<std::mutex> lock(s->mutex);
+        cJSON_AddStringToObject(root, "playback", s->device.key.c_str());
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_audioMutex);
+        cJSON_AddStringToObject(root, "capture", g_selectedCapture.key.c_str());
+    }
+    char* text = cJSON_Print(root);
+    if (text) {
+        FILE* f = fopen(kDeviceStateFile, "wb");
+        if (f) {
+            fputs(text, f);
+            fclose(f);
+        }
+        cJSON_free(text);
+    }
+    cJSON_Delete(root);
+}
+
+static std::string render_audio_list() {
+    if (!ensure_audio_context()) {
+        return "<div id=\"audio-list\"><em>Audio context init failed</em></div>";
+    }
+    std::string selected;
+    {
+        auto s = default_session();
+        std::lock_guard<std::mutex> lock(s->mutex);
+        selected = s->device.key;
+    }
+
+    auto snap = device_snapshot();
+    if (!snap) {
+        return "<div id=\"audio-list\"><em>Failed to enumerate devices</em></div>";
+    }
+    const std::vector<ma_device_info>& playback = snap->playback;
+
+    std::string html;
+    html += "<ul>";
+    for (size_t i = 0; i < playback.size(); ++i) {
+        const char* name = playback[i].name;
+        std::string key = device_key(playback[i].id);
+        bool active = (key == selected);
+        html += std::string("<li>") + (active ? "<strong>" : "") + name + (active ? "</strong>" : "");
+        html += std::string(" <button hx-post=\"/audio/select?key=") + key + "\" hx-target=\"#audio-list\" hx-swap=\"outerHTML\">Select</button>";
+        html += "</li>";
+    }
+    html += "</ul>";
+    return std::string("<div id=\"audio-list\">") + html + "</div>";
+}
+
+enum class StreamCodec {
+    Pcm16,
+    ImaAdpcm
+};
+
+// IMA-ADPCM blocks of 256 bytes per channel hold 505 frames.
+static const ma_uint32 kAdpcmBlockBytesPerChannel = 256;
+static const size_t kWavHeaderMaxBytes = 48;
+
+// WAV header with open-ended sizes for live streams. Returns the header length.
+static size_t write_wav_header(ma_uint8* out, ma_uint32 rate, ma_uint16 channels, StreamCodec codec) {
+    auto put16 = [&](size_t at, ma_uint16 v) { out[at] = (ma_uint8)v; out[at + 1] = (ma_uint8)(v >> 8); };
+    auto put32 = [&](size_t at, ma_uint32 v) { put16(at, (ma_uint16)v); put16(at + 2, (ma_uint16)(v >> 16)); };
+    memcpy(out, "RIFF", 4);
+    put32(4, 0xFFFFFFFFu);
+    memcpy(out + 8, "WAVEfmt ", 8);
+    put16(22, channels);
+    put32(24, rate);
+    size_t dataAt;
+    if (codec == StreamCodec::ImaAdpcm) {
+        ma_uint16 blockAlign = (ma_uint16)(kAdpcmBlockBytesPerChannel * channels);
+        ma_uint32 samplesPerBlock = dsp_ima_adpcm_samples_per_block(blockAlign, channels);
+        put32(16, 20);
+        put16(20, 0x11); // IMA ADPCM
+        put32(28, (ma_uint32)((ma_uint64)rate * blockAlign / samplesPerBlock));
+        put16(32, blockAlign);
+        put16(34, 4);
+        put16(36, 2); // cbSize
+        put16(38, (ma_uint16)samplesPerBlock);
+        dataAt = 40;
+    } else {
+        ma_uint16 blockAlign = (ma_uint16)(channels * 2);
+        put32(16, 16);
+        put16(20, 1); // PCM
+        put32(28, rate * blockAlign);
+        put16(32, blockAlign);
+        put16(34, 16);
+        dataAt = 36;
+    }
+    memcpy(out + dataAt, "data", 4);
+    put32(dataAt + 4, 0xFFFFFFFFu);
+    return dataAt + 8;
+}
+
+// Live streams are produced once per configuration by a generator thread that publishes
+// encoded blocks into a broadcast ring. Every HTTP listener reads at its own cursor, so
+// generation cost does not grow with the number of listeners.
+struct StreamParams {
+    DspNoiseColor color;
+    ma_uint32 rate;
+    ma_uint32 genRate; // noise is generated here and resampled to rate when they differ
+    ma_uint32 channels;
+    float amp;
+    StreamCodec codec;
+    bool fixedSeed; // reproducible stream; otherwise seeded from the clock
+    ma_uint32 seed;
+};
+
+struct BroadcastBlock {
+    std::vector<char> bytes;
+};
+
+struct StreamResampler {
+    DspResampler rs{};
+    bool ready = false;
+    StreamResampler() = default;
+    StreamResampler(const StreamResampler&) = delete;
+    StreamResampler& operator=(const StreamResampler&) = delete;
+    ~StreamResampler() { if (ready) dsp_resampler_free(&rs); }
+    bool init(ma_uint32 inRate, ma_uint32 outRate, ma_uint32 channels) {
+        ready = dsp_resampler_init(&rs, inRate, outRate, channels) == 0;
+        return ready;
+    }
+};
+
+struct Broadcast {
+    static const size_t kSlots = 64;        // ~1.4 s of history at 48 kHz
+    static const ma_uint64 kLeadBlocks = 12; // ~250 ms handed to new listeners at once
+
+    std::string key;
+    StreamParams params;
+    ma_uint32 blockFrames; // 1024 for PCM, two ADPCM blocks (1010) for ADPCM
+    StreamResampler resampler; // set up by broadcast_acquire when genRate != rate
+    std::mutex mutex; // guards everything below
+    std::condition_variable published;
+    std::shared_ptr<BroadcastBlock> slots[kSlots];
+    ma_uint64 writeSeq = 0; // blocks published so far
+    ma_uint64 drops = 0;    // listener skips caused by lagging behind the ring
+    int listeners = 0;
+    bool stop = false;
+    std::thread generator;
+};
+
+static std::mutex g_broadcastsMutex;
+static std::unordered_map<std::string, std::shared_ptr<Broadcast>> g_broadcasts;
+
+static std::string stream_key(const StreamParams& p) {
+    return std::to_string((int)p.color) + "|" + std::to_string(p.rate) + "|" + std::to_string(p.genRate) + "|" + std::to_string(p.channels) + "|" + std::to_string(p.amp) +
+        "|" + (p.codec == StreamCodec::ImaAdpcm ? "adpcm" : "pcm") + (p.fixedSeed ? "|" + std::to_string(p.seed) : std::string());
+}
+
+static void broadcast_generator(Broadcast* bc) {
+    const StreamParams p = bc->params;
+    const ma_uint32 frames = bc->blockFrames;
+    DspNoise noise;
+    dsp_noise_init(&noise, p.color, p.fixedSeed ? p.seed : (ma_uint32)std::chrono::steady_clock::now().time_since_epoch().count());
+    std::vector<float> f32((size_t)frames * p.channels);
+    std::vector<ma_int16> s16(f32.size());
+    // Source blocks at the generation rate, drained by the resampler.
+    const bool resample = p.genRate != p.rate;
+    DspResampler* resampler = &bc->resampler.rs;
+    std::vector<float> source(resample ? f32.size() : 0);
+    size_t sourceUsed = 0, sourceFrames = 0;
+    // The integer generators write s16 straight away; the resampler needs float input.
+    const bool fixedPoint = g_fixedPoint && !resample;
+    const int32_t ampQ15 = (int32_t)std::lrint(p.amp * DSP_Q15_ONE);
+    // Encoding runs once per block here, never per listener.
+    DspImaAdpcm adpcm;
+    dsp_ima_adpcm_init(&adpcm);
+    const ma_uint32 adpcmBlockAlign = kAdpcmBlockBytesPerChannel * p.channels;
+    const ma_uint32 adpcmSamples = dsp_ima_adpcm_samples_per_block(adpcmBlockAlign, p.channels);
+    const size_t blockBytes = p.codec == StreamCodec::ImaAdpcm
+        ? (size_t)(frames / adpcmSamples) * adpcmBlockAlign
+        : s16.size() * sizeof(ma_int16);
+    auto spare = std::make_shared<BroadcastBlock>();
+    const auto start = std::chrono::steady_clock::now();
+
+    for (ma_uint64 n = 0;; ++n) {
+        // Produce the lead immediately, then pace to real time.
+        if (n > Broadcast::kLeadBlocks) {
+            auto due = start + std::chrono::microseconds((n - Broadcast::kLeadBlocks) * frames * 1000000 / p.rate);
+            std::unique_lock<std::mutex> lock(bc->mutex);
+            if (bc->published.wait_until(lock, due, [bc]() { return bc->stop; })) return;
+        }
+
+        spare->bytes.resize(blockBytes);
+        ma_int16* pcm = p.codec == StreamCodec::ImaAdpcm ? s16.data() : (ma_int16*)spare->bytes.data();
+        if (fixedPoint) {
+            dsp_noise_render_s16(&noise, pcm, frames, p.channels, ampQ15, nullptr);
+        } else if (resample) {
+            size_t filled = 0;
+            while (filled < frames) {
+                if (sourceUsed == sourceFrames) {
+                    sourceFrames = frames;
+                    sourceUsed = 0;
+                    dsp_noise_render_f32(&noise, source.data(), sourceFrames, p.channels, p.amp, nullptr);
+                }
+                size_t used = 0;
+                filled += dsp_resampler_process_f32(resampler, source.data() + sourceUsed * p.channels, sourceFrames - sourceUsed, &used,
+                    f32.data() + filled * p.channels, frames - filled);
+                sourceUsed += used;
+            }
+        } else {
+            dsp_noise_render_f32(&noise, f32.data(), frames, p.channels, p.amp, nullptr);
+        }
+        if (n == 0) {
+            // A new broadcast ramps up from silence over its first block instead of clicking in.
+            if (fixedPoint) {
+                dsp_gain_ramp_s16(pcm, frames, p.channels, 0, DSP_Q30_ONE / (int32_t)frames, DSP_Q30_ONE);
+            } else {
+                dsp_gain_ramp_f32(f32.data(), frames, p.channels, 0.0f, 1.0f / (float)frames, 1.0f);
+            }
+        }
+        if (!fixedPoint) dsp_f32_to_s16(f32.data(), pcm, f32.size());
+        if (p.codec == StreamCodec::ImaAdpcm) {
+            ma_uint8* out = (ma_uint8*)spare->bytes.data();
+            for (ma_uint32 f = 0; f + adpcmSamples <= frames; f += adpcmSamples) {
+                dsp_ima_adpcm_encode_block(&adpcm, s16.data() + (size_t)f * p.channels, p.channels, adpcmSamples, out);
+                out += adpcmBlockAlign;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(bc->mutex);
+        if (bc->stop) return;
+        std::shared_ptr<BroadcastBlock>& slot = bc->slots[bc->writeSeq % Broadcast::kSlots];
+        slot.swap(spare);
+        bc->writeSeq++;
+        // Listeners only copy slots under the mutex, so a sole owner here stays sole;
+        // recycle it instead of allocating a new block.
+        if (!spare || spare.use_count() > 1) spare = std::make_shared<BroadcastBlock>();
+        bc->published.notify_all();
+    }
+}
+
+// Join or start the broadcast for params. Returns null when a new broadcast cannot set
+// up its resampler, rather than streaming at the generation rate under the wrong header.
+static std::shared_ptr<Broadcast> broadcast_acquire(const StreamParams& params) {
+    std::string key = stream_key(params);
+    std::lock_guard<std::mutex> lock(g_broadcastsMutex);
+    auto it = g_broadcasts.find(key);
+    if (it != g_broadcasts.end()) {
+        it->second->listeners++;
+        return it->second;
+    }
+    auto bc = std::make_shared<Broadcast>();
+    bc->key = key;
+    bc->params = params;
+    bc->blockFrames = params.codec == StreamCodec::ImaAdpcm
+        ? 2 * dsp_ima_adpcm_samples_per_block(kAdpcmBlockBytesPerChannel * params.channels, params.channels)
+        : 1024;
+    if (params.genRate != params.rate && !bc->resampler.init(params.genRate, params.rate, params.channels)) return nullptr;
+    bc->listeners = 1;
+    bc->generator = std::thread(broadcast_generator, bc.get());
+    g_broadcasts[key] = bc;
+    return bc;
+}
+
+static void broadcast_release(const std::shared_ptr<Broadcast>& bc) {
+    {
+        std::lock_guard<std::mutex> lock(g_broadcastsMutex);
+        if (--bc->listeners > 0) return;
+        g_broadcasts.erase(bc->key);
+    }
+    {
+        std::lock_guard<std::mutex> lock(bc->mutex);
+        bc->stop = true;
+    }
+    bc->published.notify_all();
+    if (bc->generator.joinable()) bc->generator.join();
+}
+
+// Listener side: hand out the next block at this cursor, jumping forward if the
+// generator has lapped us. Returns false on shutdown.
+static bool broadcast_next(Broadcast& bc, ma_uint64& cursor, std::shared_ptr<BroadcastBlock>& out) {
+    std::unique_lock<std::mutex> lock(bc.mutex);
+    bc.published.wait(lock, [&]() { return bc.stop || bc.writeSeq > cursor; });
+    if (bc.stop) return false;
+    if (bc.writeSeq - cursor > Broadcast::kSlots) {
+        cursor = bc.writeSeq - Broadcast::kLeadBlocks;
+        bc.drops++;
+    }
+    out = bc.slots[cursor % Broadcast::kSlots];
+    cursor++;
+    return true;
+}
+
+// Latest capture block levels, published by the capture callback through a seqlock so
+// readers never block the audio thread.
+struct CaptureLevels {
+    std::atomic<ma_uint32> seq{0};
+    std::atomic<float> rms{0.0f};
+    std::atomic<float> peak{0.0f};
+    std::atomic<ma_uint64> clipCount{0};
+    std::atomic<ma_uint64> blocks{0};
+};
+
+struct CaptureLevelsSnapshot {
+    float rms;
+    float peak;
+    ma_uint64 clipCount;
+    ma_uint64 blocks;
+};
+
+static ma_device g_captureDevice;
+static bool g_captureDeviceInited = false;
+static std::atomic<bool> g_captureStopping{false};
+
+static bool device_stopping_on_purpose(ma_device* device) {
+    if (device == &g_captureDevice) return g_captureStopping.load(std::memory_order_acquire);
+    const NoiseState* st = (const NoiseState*)device->pUserData;
+    return st && st->stopping.load(std::memory_order_acquire);
+}
+
+static CaptureLevels g_captureLevels;
+
+// Spectrum analyzer: the capture callback feeds a mono mix into a lock-free ring and a
+// worker thread turns the most recent window into log-spaced dB bins for SSE clients.
+static const size_t kSpectrumRingSize = 8192; // power of two, > kSpectrumFftSize
+static const size_t kSpectrumFftSize = 2048;
+static const size_t kSpectrumBins = 48;
+static const float kSpectrumMinHz = 20.0f;
+
+struct SpectrumAnalyzer {
+    std::atomic<float> ring[kSpectrumRingSize];
+    std::atomic<ma_uint64> written{0};
+
+    std::thread worker;
+    std::mutex mutex; // guards everything below
+    std::condition_variable wakeWorker;
+    std::condition_variable frameReady;
+    bool stopWorker = false;
+    bool shutdown = false;
+    ma_uint32 fps = 15;
+    ma_uint32 sampleRate = 48000;
+    std::string frame; // latest SSE event
+    ma_uint64 frameSeq = 0;
+};
+
+static SpectrumAnalyzer g_spectrum;
+
+static void spectrum_push(const float* in, ma_uint32 frameCount, ma_uint32 channels) {
+    ma_uint64 w = g_spectrum.written.load(std::memory_order_relaxed);
+    const float scale = 1.0f / (float)channels;
+    for (ma_uint32 f = 0; f < frameCount; ++f) {
+        float sum = 0.0f;
+        for (ma_uint32 c = 0; c < channels; ++c) sum += in[f * channels + c];
+        g_spectrum.ring[(w + f) & (kSpectrumRingSize - 1)].store(sum * scale, std::memory_order_relaxed);
+    }
+    g_spectrum.written.store(w + frameCount, std::memory_order_release);
+}
+
+static void spectrum_worker() {
+    float* window = (float*)dsp_aligned_alloc(kSpectrumFftSize * sizeof(float));
+    float* re = (float*)dsp_aligned_alloc(kSpectrumFftSize * sizeof(float));
+    float* im = (float*)dsp_aligned_alloc(kSpectrumFftSize * sizeof(float));
+    float* power = (float*)dsp_aligned_alloc((kSpectrumFftSize / 2 + 1) * sizeof(float));
+    DspFft fft;
+    bool ok = window && re && im && power && dsp_fft_init(&fft, kSpectrumFftSize) == 0;
+    uint32_t edges[kSpectrumBins + 1];
+    float db[kSpectrumBins];
+    ma_uint32 fps;
+    {
+        std::lock_guard<std::mutex> lock(g_spectrum.mutex);
+        fps = g_spectrum.fps;
+        dsp_log_bin_edges(edges, kSpectrumBins, kSpectrumFftSize, (float)g_spectrum.sampleRate, kSpectrumMinHz);
+    }
+    float windowSum = 0.0f;
+    if (ok) {
+        dsp_window_hann(window, kSpectrumFftSize);
+        for (size_t i = 0; i < kSpectrumFftSize; ++i) windowSum += window[i];
+    }
+    // Scale so a full-scale sine reads 0 dB.
+    const float norm = ok ? 4.0f / (windowSum * windowSum) : 0.0f;
+    std::string event;
+    event.reserve(16 + kSpectrumBins * 5);
+
+    auto period = std::chrono::microseconds(1000000 / fps);
+    auto next = std::chrono::steady_clock::now();
+    while (ok) {
+        next += period;
+        {
+            std::unique_lock<std::mutex> lock(g_spectrum.mutex);
+            if (g_spectrum.wakeWorker.wait_until(lock, next, []() { return g_spectrum.stopWorker; })) break;
+        }
+        ma_uint64 w = g_spectrum.written.load(std::memory_order_acquire);
+        if (w < kSpectrumFftSize) continue;
+        ma_uint64 start = w - kSpectrumFftSize;
+        for (size_t i = 0; i < kSpectrumFftSize; ++i) {
+            re[i] = g_spectrum.ring[(start + i) & (kSpectrumRingSize - 1)].load(std::memory_order_relaxed) * window[i];
+            im[i] = 0.0f;
+        }
+        dsp_fft(&fft, re, im, 0);
+        for (size_t k = 0; k <= kSpectrumFftSize / 2; ++k) {
+            power[k] = (re[k] * re[k] + im[k] * im[k]) * norm;
+        }
+        dsp_power_to_log_bins_db(power, edges, kSpectrumBins, db);
+
+        event.assign("data: [");
+        for (size_t b = 0; b < kSpectrumBins; ++b) {
+            float v = db[b] < -120.0f ? -120.0f : (db[b] > 0.0f ? 0.0f : db[b]);
+            if (b) event += ',';
+            event += std::to_string((int)std::lround(v));
+        }
+        event += "]\n\n";
+        {
+            std::lock_guard<std::mutex> lock(g_spectrum.mutex);
+            g_spectrum.frame.swap(event);
+            g_spectrum.frameSeq++;
+        }
+        g_spectrum.frameReady.notify_all();
+    }
+
+    if (ok) dsp_fft_free(&fft);
+    dsp_aligned_free(window);
+    dsp_aligned_free(re);
+    dsp_aligned_free(im);
+    dsp_aligned_free(power);
+}
+
+static void spectrum_start(ma_uint32 sampleRate, ma_uint32 fps) {
+    g_spectrum.written.store(0, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(g_spectrum.mutex);
+        g_spectrum.stopWorker = false;
+        g_spectrum.sampleRate = sampleRate;
+        g_spectrum.fps = fps;
+    }
+    g_spectrum.worker = std::thread(spectrum_worker);
+}
+
+static void spectrum_stop() {
+    {
+        std::lock_guard<std::mutex> lock(g_spectrum.mutex);
+        g_spectrum.stopWorker = true;
+    }
+    g_spectrum.wakeWorker.notify_all();
+    if (g_spectrum.worker.joinable()) g_spectrum.worker.join();
+}
+
+static void capture_callback(ma_device* device, void* out, const void* in, ma_uint32 frameCount) {
+    (void)out;
+    if (!in || frameCount == 0) return;
+    size_t n = (size_t)frameCount * device->capture.channels;
+    DspLevels levels;
+    dsp_levels_f32((const float*)in, n, &levels);
+    spectrum_push((const float*)in, frameCount, device->capture.channels);
 
-static void ensure_audio_context() {
-    std::lock_guard<std::mutex> lock(g_audioMutex);
-    if (!g_ctx_inited) {
-        if (ma_context_init(nullptr, 0, nullptr, &g_ctx) != MA_SUCCESS) {
-            // Failed; leave uninitialized
-            return;
-        }
-        g_ctx_inited = true;
+    // Single writer: odd sequence marks an update in progress.
+    CaptureLevels& lv = g_captureLevels;
+    ma_uint32 seq = lv.seq.load(std::memory_order_relaxed);
+    lv.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    lv.rms.store(std::sqrt(levels.sumSquares / (float)n), std::memory_order_relaxed);
+    lv.peak.store(levels.peak, std::memory_order_relaxed);
+    lv.clipCount.store(lv.clipCount.load(std::memory_order_relaxed) + levels.clipCount, std::memory_order_relaxed);
+    lv.blocks.store(lv.blocks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    lv.seq.store(seq + 2, std::memory_order_release);
+}
+
+static CaptureLevelsSnapshot read_capture_levels() {
+    const CaptureLevels& lv = g_captureLevels;
+    CaptureLevelsSnapshot snap;
+    for (;;) {
+        ma_uint32 before = lv.seq.load(std::memory_order_acquire);
+        if (before & 1u) continue;
+        snap.rms = lv.rms.load(std::memory_order_relaxed);
+        snap.peak = lv.peak.load(std::memory_order_relaxed);
+        snap.clipCount = lv.clipCount.load(std::memory_order_relaxed);
+        snap.blocks = lv.blocks.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (lv.seq.load(std::memory_order_relaxed) == before) return snap;
     }
 }
 
-static std::string render_ble_list() {
-    using namespace SimpleBLE;
-    std::string html;
-    html += "<table><thead><tr><th>Name</th><th>Address</th><th>Status</th><th>Action</th></tr></thead><tbody>";
-    try {
-        auto adapters = Adapter::get_adapters();
-        if (adapters.empty()) {
-            html += "<tr><td colspan=4>No adapters found</td></tr>";
-        } else {
-            auto adapter = adapters.front();
-            auto peripherals = adapter.get_paired_peripherals();
-            if (peripherals.empty()) {
-                html += "<tr><td colspan=4>No devices found</td></tr>";
-            } else {
-                for (auto& p : peripherals) {
-                    auto name = p.identifier();
-                    auto addr = p.address();
-                    bool connected = false;
-                    try { connected = p.is_connected(); } catch(...) { connected = false; }
-                    html += "<tr>";
-                    html += std::string("<td>") + (name.empty()?"&lt;unknown&gt;":name) + "</td>";
-                    html += std::string("<td>") + addr + "</td>";
-                    html += std::string("<td>") + (connected?"connected":"disconnected") + "</td>";
-                    html += std::string("<td><button hx-post=\"/ble/toggle?address=") + addr + "\" hx-target=\"#ble-list\" hx-swap=\"outerHTML\">Toggle</button></td>";
-                    html += "</tr>";
-                }
-            }
-        }
-    } catch(...) {
-        html += "<tr><td colspan=4>Error listing BLE devices</td></tr>";
+static void stop_capture_locked() {
+    if (g_captureDeviceInited) {
+        g_captureStopping.store(true, std::memory_order_release);
+        ma_device_uninit(&g_captureDevice);
+        g_captureDeviceInited = false;
+        spectrum_stop();
     }
-    html += "</tbody></table>";
-    return std::string("<div id=\"ble-list\">") + html + "</div>";
 }
 
-static std::string render_audio_list() {
-    ensure_audio_context();
+static bool start_capture(ma_uint32 rate, ma_uint32 channels, ma_uint32 spectrumFps) {
+    if (!ensure_audio_context()) return false;
     std::lock_guard<std::mutex> lock(g_audioMutex);
-    if (!g_ctx_inited) {
-        return "<div id=\"audio-list\"><em>Audio context init failed</em></div>";
-    }
+    stop_capture_locked();
 
-    ma_device_info* pPlaybackInfos = nullptr;
-    ma_uint32 playbackCount = 0;
-    ma_device_info* pCaptureInfos = nullptr;
-    ma_uint32 captureCount = 0;
+    ma_device_config config = ma_device_config_init(ma_device_type_capture);
+    config.capture.format = ma_format_f32;
+    config.capture.channels = channels;
+    config.sampleRate = rate;
+    config.dataCallback = capture_callback;
+    config.notificationCallback = device_notification_callback;
 
-    if (ma_context_get_devices(&g_ctx, &pPlaybackInfos, &playbackCount, &pCaptureInfos, &captureCount) != MA_SUCCESS) {
-        return "<div id=\"audio-list\"><em>Failed to enumerate devices</em></div>";
+    auto snap = device_snapshot();
+    ma_device_id captureId;
+    if (resolve_selection(g_selectedCapture, snap ? &snap->captureByKey : nullptr, &captureId)) {
+        config.capture.pDeviceID = &captureId;
     }
 
-    std::string html;
-    html += "<ul>";
-    for (ma_uint32 i = 0; i < playbackCount; ++i) {
-        const char* name = pPlaybackInfos[i].name ? pPlaybackInfos[i].name : "<unknown>";
-        bool active = ((int)i == g_selectedPlaybackIndex);
-        html += std::string("<li>") + (active ? "<strong>" : "") + name + (active ? "</strong>" : "");
-        html += std::string(" <button hx-post=\"/audio/select?index=") + std::to_string(i) + "\" hx-target=\"#audio-list\" hx-swap=\"outerHTML\">Select</button>";
-        html += "</li>";
+    if (ma_device_init(&g_ctx, &config, &g_captureDevice) != MA_SUCCESS) {
+        return false;
     }
-    html += "</ul>";
-    return std::string("<div id=\"audio-list\">") + html + "</div>";
+    g_captureDeviceInited = true;
+    spectrum_start(g_captureDevice.sampleRate, spectrumFps);
+    g_captureStopping.store(false, std::memory_order_release);
+    if (ma_device_start(&g_captureDevice) != MA_SUCCESS) {
+        stop_capture_locked();
+        return false;
+    }
+    return true;
 }
 
-struct NoiseState {
-    float amplitude;
-    ma_uint32 channels;
-    unsigned int seed;
-};
+static void stop_capture() {
+    std::lock_guard<std::mutex> lock(g_audioMutex);
+    stop_capture_locked();
+}
 
-static inline float frand_signed(unsigned int* s) {
-    *s = (*s * 1664525u) + 1013904223u;
-    float v = (float)(*s & 0x00FFFFFF) / (float)0x01000000;
-    return (v * 2.0f) - 1.0f;
+static double to_dbfs(float v) {
+    return v > 0.0f ? 20.0 * std::log10((double)v) : -120.0;
 }
 
-static void data_callback(ma_device* device, void* out, const void* in, ma_uint32 frameCount) {
-    NoiseState* st = (NoiseState*)device->pUserData;
-    float* f32 = (float*)out;
-    ma_uint64 total = (ma_uint64)frameCount * st->channels;
-    for (ma_uint64 i = 0; i < total; ++i) {
-        f32[i] = frand_signed(&st->seed) * st->amplitude;
+static std::string render_capture_levels_json() {
+    bool running;
+    {
+        std::lock_guard<std::mutex> lock(g_audioMutex);
+        running = g_captureDeviceInited;
     }
-    (void)in;
+    CaptureLevelsSnapshot snap = read_capture_levels();
+    cJSON* root = cJSON_CreateObject();
+    cJSON_AddBoolToObject(root, "running", running);
+    cJSON_AddNumberToObject(root, "rms", snap.rms);
+    cJSON_AddNumberToObject(root, "rms_dbfs", to_dbfs(snap.rms));
+    cJSON_AddNumberToObject(root, "peak", snap.peak);
+    cJSON_AddNumberToObject(root, "peak_dbfs", to_dbfs(snap.peak));
+    cJSON_AddNumberToObject(root, "clips", (double)snap.clipCount);
+    cJSON_AddNumberToObject(root, "blocks", (double)snap.blocks);
+    char* text = cJSON_PrintUnformatted(root);
+    std::string json = text ? text : "{}";
+    cJSON_free(text);
+    cJSON_Delete(root);
+    return json;
 }
 
-// Persistent noise device to avoid spawning a thread per request.
-static ma_device g_noiseDevice;
-static bool g_noiseDeviceInited = false;
-static bool g_noiseRunning = false;
-static NoiseState g_noiseState{};
-static std::thread g_noiseMonitor;
-static std::atomic<bool> g_monitorRunning{false};
-static bool g_hasDeadline = false;
-static std::chrono::steady_clock::time_point g_noiseStopAt;
-
-static void start_monitor_if_needed() {
-    if (!g_monitorRunning.load()) {
-        g_monitorRunning.store(true);
-        g_noiseMonitor = std::thread([]() {
-            while (g_monitorRunning.load()) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                std::lock_guard<std::mutex> lock(g_audioMutex);
-                if (g_noiseRunning && g_hasDeadline) {
-                    if (std::chrono::steady_clock::now() >= g_noiseStopAt) {
-                        ma_device_stop(&g_noiseDevice);
-                        g_noiseRunning = false;
-                        if (g_noiseDeviceInited) {
-                            ma_device_uninit(&g_noiseDevice);
-                            g_noiseDeviceInited = false;
-                        }
-                        g_hasDeadline = false;
-                    }
-                }
-            }
-        });
+// Streaming responses hold an HTTP worker for as long as the client listens. The pool
+// has a thread for each of kMaxStreamClients plus kRequestThreads for ordinary requests,
+// and streams past the cap are turned away so those requests never starve.
+static const int kMaxStreamClients = 16;
+static const int kRequestThreads = 8;
+static std::atomic<int> g_streamClients{0};
+
+// Claim a stream slot, or answer 503 when all are taken. The response's content provider
+// releaser must call stream_client_release.
+static bool stream_client_acquire(httplib::Response& res) {
+    if (g_streamClients.fetch_add(1, std::memory_order_relaxed) < kMaxStreamClients) return true;
+    g_streamClients.fetch_sub(1, std::memory_order_relaxed);
+    res.status = 503;
+    res.set_header("Retry-After", "5");
+    res.set_content("Too many streaming clients", "text/plain");
+    return false;
+}
+
+static void stream_client_release() {
+    g_streamClients.fetch_sub(1, std::memory_order_relaxed);
+}
+
+static void add_session_fields_locked(cJSON* obj, PlaybackSession& s) {
+    cJSON_AddStringToObject(obj, "device", s.device.key.c_str());
+    cJSON_AddBoolToObject(obj, "open", s.output != nullptr);
+    cJSON_AddBoolToObject(obj, "running", s.output && s.output->running);
+    cJSON_AddBoolToObject(obj, "playing", s.output && s.output->armed);
+    cJSON_AddNumberToObject(obj, "inits", (double)s.outputInits);
+    cJSON_AddNumberToObject(obj, "reuses", (double)s.outputReuses);
+    cJSON_AddBoolToObject(obj, "standby", s.standby);
+    cJSON_AddStringToObject(obj, "filter", filter_type_name(s.output && s.output->armed ? s.output->params.filter.type : FilterType::None));
+}
+
+static void add_latency_json(cJSON* parent, const StartLatency& l) {
+    cJSON* jlat = cJSON_AddObjectToObject(parent, "first_sample_latency_us");
+    ma_uint64 n = l.count.load(std::memory_order_relaxed);
+    cJSON_AddNumberToObject(jlat, "count", (double)n);
+    cJSON_AddNumberToObject(jlat, "last", (double)l.lastUs.load(std::memory_order_relaxed));
+    cJSON_AddNumberToObject(jlat, "min", (double)l.minUs.load(std::memory_order_relaxed));
+    cJSON_AddNumberToObject(jlat, "max", (double)l.maxUs.load(std::memory_order_relaxed));
+    cJSON_AddNumberToObject(jlat, "mean", n ? (double)l.sumUs.load(std::memory_order_relaxed) / (double)n : 0.0);
+}
+
+static void add_loudness_json(cJSON* parent, const LoudnessMeter& m) {
+    cJSON* jl = cJSON_AddObjectToObject(parent, "loudness");
+    cJSON_AddNumberToObject(jl, "momentary_lufs", m.momentary.load(std::memory_order_relaxed));
+    cJSON_AddNumberToObject(jl, "short_term_lufs", m.shortTerm.load(std::memory_order_relaxed));
+    cJSON_AddNumberToObject(jl, "integrated_lufs", m.integrated.load(std::memory_order_relaxed));
+    if (m.normalize.load(std::memory_order_relaxed)) {
+        cJSON_AddNumberToObject(jl, "target_lufs", m.targetLufs.load(std::memory_order_relaxed));
+    } else {
+        cJSON_AddNullToObject(jl, "target_lufs");
     }
+    cJSON_AddNumberToObject(jl, "gain_db", m.normalize.load(std::memory_order_relaxed) ? 20.0 * std::log10(m.gain.load(std::memory_order_relaxed)) : 0.0);
+    cJSON_AddNumberToObject(jl, "dropped_samples", (double)m.droppedSamples.load(std::memory_order_relaxed));
 }
 
-static bool start_noise(ma_uint32 rate, ma_uint32 channels, float amp, ma_uint32 duration_ms) {
-    ensure_audio_context();
-    std::lock_guard<std::mutex> lock(g_audioMutex);
-    if (!g_ctx_inited) return false;
+static void add_limiter_json(cJSON* parent, const LimiterControl& lc) {
+    cJSON* jl = cJSON_AddObjectToObject(parent, "limiter");
+    cJSON_AddBoolToObject(jl, "enabled", lc.enabled.load(std::memory_order_relaxed));
+    cJSON_AddNumberToObject(jl, "ceiling_db", 20.0 * std::log10(lc.ceiling.load(std::memory_order_relaxed)));
+    cJSON_AddNumberToObject(jl, "lookahead_ms", kLimiterLookaheadMs);
+    cJSON_AddNumberToObject(jl, "gain_reduction_db", lc.gainReductionDb.load(std::memory_order_relaxed));
+    cJSON_AddNumberToObject(jl, "max_gain_reduction_db", lc.maxGainReductionDb.load(std::memory_order_relaxed));
+    cJSON_AddNumberToObject(jl, "limited_blocks", (double)lc.limitedBlocks.load(std::memory_order_relaxed));
+}
+
+static cJSON* session_json(PlaybackSession& s) {
+    cJSON* obj = cJSON_CreateObject();
+    cJSON_AddStringToObject(obj, "id", s.id.c_str());
+    std::lock_guard<std::mutex> lock(s.mutex);
+    add_session_fields_locked(obj, s);
+    add_latency_json(obj, s.latency);
+    add_loudness_json(obj, *s.loudness);
+    add_limiter_json(obj, s.limiter);
+    return obj;
+}
 
-    // If already running, stop and uninit so we can reconfigure.
-    if (g_noiseRunning) {
-        ma_device_stop(&g_noiseDevice);
-        g_noiseRunning = false;
+static std::string print_json(cJSON* root) {
+    char* text = cJSON_PrintUnformatted(root);
+    std::string json = text ? text : "{}";
+    cJSON_free(text);
+    cJSON_Delete(root);
+    return json;
+}
+
+static std::string render_stats_json() {
+    cJSON* root = cJSON_CreateObject();
+    cJSON* jcache = cJSON_AddObjectToObject(root, "clip_cache");
+    {
+        std::lock_guard<std::mutex> lock(g_clipCache.mutex);
+        cJSON_AddNumberToObject(jcache, "hits", (double)g_clipCache.hits);
+        cJSON_AddNumberToObject(jcache, "misses", (double)g_clipCache.misses);
+        cJSON_AddNumberToObject(jcache, "evictions", (double)g_clipCache.evictions);
+        cJSON_AddNumberToObject(jcache, "entries", (double)g_clipCache.lru.size());
+        cJSON_AddNumberToObject(jcache, "bytes", (double)g_clipCache.bytes);
+        cJSON_AddNumberToObject(jcache, "capacity_bytes", (double)g_clipCache.capacityBytes);
+    }
+    {
+        cJSON* jir = cJSON_AddObjectToObject(root, "ir_cache");
+        std::lock_guard<std::mutex> lock(g_irCache.mutex);
+        cJSON_AddNumberToObject(jir, "hits", (double)g_irCache.hits);
+        cJSON_AddNumberToObject(jir, "misses", (double)g_irCache.misses);
+        cJSON_AddNumberToObject(jir, "entries", (double)g_irCache.entries.size());
+    }
+    cJSON_AddStringToObject(root, "dsp_path", dsp_path_name(dsp_active_path()));
+    cJSON_AddBoolToObject(root, "fixed_point_streams", g_fixedPoint);
+    cJSON_AddNumberToObject(root, "stream_clients", g_streamClients.load(std::memory_order_relaxed));
+    auto snap = device_snapshot();
+    cJSON_AddNumberToObject(root, "device_list_version", snap ? (double)snap->version : 0.0);
+    {
+        // "output" and "first_sample_latency_us" describe the default session.
+        auto s = default_session();
+        std::lock_guard<std::mutex> lock(s->mutex);
+        add_session_fields_locked(cJSON_AddObjectToObject(root, "output"), *s);
+        add_latency_json(root, s->latency);
     }
-    if (g_noiseDeviceInited) {
-        ma_device_uninit(&g_noiseDevice);
-        g_noiseDeviceInited = false;
+    cJSON* jsessions = cJSON_AddArrayToObject(root, "sessions");
+    for (auto& s : list_sessions()) {
+        cJSON_AddItemToArray(jsessions, session_json(*s));
     }
+    cJSON* jstreams = cJSON_AddArrayToObject(root, "streams");
+    {
+        std::lock_guard<std::mutex> lock(g_broadcastsMutex);
+        for (auto& kv : g_broadcasts) {
+            Broadcast& bc = *kv.second;
+            cJSON* js = cJSON_CreateObject();
+            cJSON_AddStringToObject(js, "key", bc.key.c_str());
+            cJSON_AddNumberToObject(js, "listeners", bc.listeners);
+            std::lock_guard<std::mutex> bcLock(bc.mutex);
+            cJSON_AddNumberToObject(js, "blocks", (double)bc.writeSeq);
+            cJSON_AddNumberToObject(js, "drops", (double)bc.drops);
+            cJSON_AddItemToArray(jstreams, js);
+        }
+    }
+    return print_json(root);
+}
 
-    ma_device_config config = ma_device_config_init(ma_device_type_playback);
-    config.playback.format = ma_format_f32;
-    config.playback.channels = channels;
-    config.sampleRate = rate;
-    config.dataCallback = data_callback;
+// Request bodies shared by the default-session endpoints under /audio and the
+// per-session ones under /audio/sessions/{id}.
 
-    ma_device_info* pPlaybackInfos = nullptr;
-    ma_uint32 playbackCount = 0;
-    if (ma_context_get_devices(&g_ctx, &pPlaybackInfos, &playbackCount, nullptr, nullptr) == MA_SUCCESS) {
-        if (g_selectedPlaybackIndex >= 0 && (ma_uint32)g_selectedPlaybackIndex < playbackCount) {
-            config.playback.pDeviceID = &pPlaybackInfos[g_selectedPlaybackIndex].id;
+// Optional "channel_map" (array of position names or "FL,FR,..."; sets the channel
+// count), "gains" (linear, per channel) and "mute" (channel indices). Invalid maps are
+// ignored like other malformed fields.
+static void parse_channel_layout(cJSON* root, ma_uint32* channels, ChannelLayout& out) {
+    cJSON* jmap = cJSON_GetObjectItemCaseSensitive(root, "channel_map");
+    ma_channel map[DSP_MAX_CHANNELS];
+    int count = -1;
+    if (cJSON_IsString(jmap) && jmap->valuestring) {
+        count = channel_map_parse(jmap->valuestring, map, DSP_MAX_CHANNELS);
+    } else if (cJSON_IsArray(jmap)) {
+        count = 0;
+        cJSON* item;
+        cJSON_ArrayForEach(item, jmap) {
+            if (!cJSON_IsString(item) || count >= DSP_MAX_CHANNELS || channel_from_name(item->valuestring, &map[count]) != 0) {
+                count = -1;
+                break;
+            }
+            count++;
         }
     }
+    if (count > 0) {
+        out.map.assign(map, map + count);
+        *channels = (ma_uint32)count;
+    }
 
-    g_noiseState.amplitude = amp;
-    g_noiseState.channels = channels;
-    g_noiseState.seed = 1234567u;
-    config.pUserData = &g_noiseState;
-
-    if (ma_device_init(&g_ctx, &config, &g_noiseDevice) != MA_SUCCESS) {
-        return false;
+    std::vector<float> gains(DSP_MAX_CHANNELS, 1.0f);
+    bool anyGain = false;
+    cJSON* jgains = cJSON_GetObjectItemCaseSensitive(root, "gains");
+    if (cJSON_IsArray(jgains)) {
+        int c = 0;
+        cJSON* item;
+        cJSON_ArrayForEach(item, jgains) {
+            if (c >= DSP_MAX_CHANNELS) break;
+            if (cJSON_IsNumber(item)) {
+                gains[c] = std::min(std::max((float)item->valuedouble, 0.0f), 4.0f);
+                anyGain = true;
+            }
+            c++;
+        }
     }
-    g_noiseDeviceInited = true;
-    if (ma_device_start(&g_noiseDevice) != MA_SUCCESS) {
-        ma_device_uninit(&g_noiseDevice);
-        g_noiseDeviceInited = false;
-        return false;
+    cJSON* jmute = cJSON_GetObjectItemCaseSensitive(root, "mute");
+    if (cJSON_IsArray(jmute)) {
+        cJSON* item;
+        cJSON_ArrayForEach(item, jmute) {
+            if (cJSON_IsNumber(item) && item->valuedouble >= 0 && item->valuedouble < DSP_MAX_CHANNELS) {
+                gains[(size_t)item->valuedouble] = 0.0f;
+                anyGain = true;
+            }
+        }
+    }
+    if (anyGain) out.gains = std::move(gains);
+}
+
+// Drop a map that no longer matches the clamped channel count and size the gains.
+static void finish_channel_layout(ChannelLayout& layout, ma_uint32 channels) {
+    if (layout.map.size() != channels) layout.map.clear();
+    if (!layout.gains.empty()) layout.gains.resize(channels);
+}
+
+// Optional "reverb" (IR file name under irs/) with "wet" and "dry" gains.
+struct ReverbRequest {
+    std::string ir;
+    float wet = 0.3f;
+    float dry = 1.0f;
+};
+
+static void parse_reverb_request(cJSON* root, ReverbRequest& out) {
+    cJSON* jir = cJSON_GetObjectItemCaseSensitive(root, "reverb");
+    cJSON* jwet = cJSON_GetObjectItemCaseSensitive(root, "wet");
+    cJSON* jdry = cJSON_GetObjectItemCaseSensitive(root, "dry");
+    if (cJSON_IsString(jir) && jir->valuestring) out.ir = jir->valuestring;
+    if (cJSON_IsNumber(jwet)) out.wet = std::min(std::max((float)jwet->valuedouble, 0.0f), 4.0f);
+    if (cJSON_IsNumber(jdry)) out.dry = std::min(std::max((float)jdry->valuedouble, 0.0f), 1.0f);
+}
+
+// Load the requested IR for rate. Returns an HTTP status: 200 (also when no reverb was
+// asked for), 400 for a bad name or 404 when the file cannot be decoded.
+static int resolve_reverb(const ReverbRequest& r, ma_uint32 rate, ReverbSpec* out) {
+    if (r.ir.empty()) return 200;
+    std::string path;
+    if (!resolve_clip_path(r.ir, path, kIrDir)) return 400;
+    out->ir = ir_cache_get(g_irCache, path, rate);
+    if (!out->ir) return 404;
+    out->wet = r.wet;
+    out->dry = r.dry;
+    return 200;
+}
+
+struct NoiseRequest {
+    ma_uint32 rate = 48000;
+    ma_uint32 channels = 2;
+    ma_uint32 duration_ms = 3000;
+    float amp = 0.2f;
+    DspNoiseColor color = DSP_NOISE_WHITE;
+    ma_uint32 seed = kDefaultNoiseSeed;
+    ChannelLayout layout;
+    NoiseFilter filter;
+    ReverbRequest reverb;
+};
+
+static NoiseRequest parse_noise_request(const std::string& body) {
+    NoiseRequest r;
+    if (!body.empty()) {
+        cJSON* root = cJSON_Parse(body.c_str());
+        if (root) {
+            cJSON* jrate = cJSON_GetObjectItemCaseSensitive(root, "rate");
+            cJSON* jch = cJSON_GetObjectItemCaseSensitive(root, "channels");
+            cJSON* jdur = cJSON_GetObjectItemCaseSensitive(root, "duration_ms");
+            cJSON* jamp = cJSON_GetObjectItemCaseSensitive(root, "amp");
+            cJSON* jcolor = cJSON_GetObjectItemCaseSensitive(root, "color");
+            cJSON* jseed = cJSON_GetObjectItemCaseSensitive(root, "seed");
+            if (cJSON_IsNumber(jrate)) r.rate = (ma_uint32)jrate->valuedouble;
+            if (cJSON_IsNumber(jch)) r.channels = (ma_uint32)jch->valuedouble;
+            if (cJSON_IsNumber(jdur)) r.duration_ms = (ma_uint32)jdur->valuedouble;
+            if (cJSON_IsNumber(jamp)) r.amp = (float)jamp->valuedouble;
+            if (cJSON_IsString(jcolor) && jcolor->valuestring) dsp_noise_color_from_name(jcolor->valuestring, &r.color);
+            if (cJSON_IsNumber(jseed) && jseed->valuedouble >= 0.0 && jseed->valuedouble <= 4294967295.0) r.seed = (ma_uint32)jseed->valuedouble;
+            // "filter": "lowpass" | "highpass" | "bandpass", with "cutoff_hz", "q" and
+            // "slope_db" (12 or 24).
+            cJSON* jfilter = cJSON_GetObjectItemCaseSensitive(root, "filter");
+            cJSON* jhz = cJSON_GetObjectItemCaseSensitive(root, "cutoff_hz");
+            cJSON* jq = cJSON_GetObjectItemCaseSensitive(root, "q");
+            cJSON* jslope = cJSON_GetObjectItemCaseSensitive(root, "slope_db");
+            if (cJSON_IsString(jfilter) && jfilter->valuestring) filter_type_from_name(jfilter->valuestring, &r.filter.type);
+            if (cJSON_IsNumber(jhz)) r.filter.hz = (float)jhz->valuedouble;
+            if (cJSON_IsNumber(jq)) r.filter.q = (float)jq->valuedouble;
+            if (cJSON_IsNumber(jslope)) r.filter.steep = jslope->valuedouble >= 24.0;
+            parse_reverb_request(root, r.reverb);
+            parse_channel_layout(root, &r.channels, r.layout);
+            cJSON_Delete(root);
+        }
     }
-    g_noiseRunning = true;
-    g_hasDeadline = duration_ms > 0;
-    if (g_hasDeadline) {
-        g_noiseStopAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(duration_ms);
-        start_monitor_if_needed();
+    if (r.channels == 0 || r.channels > DSP_MAX_CHANNELS) r.channels = 2;
+    finish_channel_layout(r.layout, r.channels);
+    if (r.filter.q < 0.1f) r.filter.q = 0.1f;
+    if (r.filter.q > 20.0f) r.filter.q = 20.0f;
+    if (r.rate < 8000) r.rate = 8000;
+    if (r.amp < 0.0f) r.amp = 0.0f;
+    if (r.amp > 1.0f) r.amp = 1.0f;
+    if (r.duration_ms < 100) r.duration_ms = 100;
+    return r;
+}
+
+struct StandbyRequest {
+    bool enabled = true;
+    ma_uint32 rate = 48000;
+    ma_uint32 channels = 2;
+    ChannelLayout layout;
+};
+
+static StandbyRequest parse_standby_request(const std::string& body) {
+    StandbyRequest r;
+    if (!body.empty()) {
+        cJSON* root = cJSON_Parse(body.c_str());
+        if (root) {
+            cJSON* jen = cJSON_GetObjectItemCaseSensitive(root, "enabled");
+            cJSON* jrate = cJSON_GetObjectItemCaseSensitive(root, "rate");
+            cJSON* jch = cJSON_GetObjectItemCaseSensitive(root, "channels");
+            if (cJSON_IsBool(jen)) r.enabled = cJSON_IsTrue(jen);
+            if (cJSON_IsNumber(jrate)) r.rate = (ma_uint32)jrate->valuedouble;
+            if (cJSON_IsNumber(jch)) r.channels = (ma_uint32)jch->valuedouble;
+            parse_channel_layout(root, &r.channels, r.layout);
+            cJSON_Delete(root);
+        }
     }
-    return true;
+    if (r.channels == 0 || r.channels > DSP_MAX_CHANNELS) r.channels = 2;
+    if (r.rate < 8000) r.rate = 8000;
+    finish_channel_layout(r.layout, r.channels);
+    return r;
 }
 
-static void stop_noise() {
-    std::lock_guard<std::mutex> lock(g_audioMutex);
-    if (g_noiseRunning) {
-        ma_device_stop(&g_noiseDevice);
-        g_noiseRunning = false;
+struct ClipRequest {
+    std::string name;
+    ma_uint32 rate = 48000;
+    ma_uint32 channels = 2;
+    float amp = 1.0f;
+    ChannelLayout layout;
+    ReverbRequest reverb;
+};
+
+static ClipRequest parse_clip_request(const std::string& body) {
+    ClipRequest r;
+    if (!body.empty()) {
+        cJSON* root = cJSON_Parse(body.c_str());
+        if (root) {
+            cJSON* jpath = cJSON_GetObjectItemCaseSensitive(root, "path");
+            cJSON* jrate = cJSON_GetObjectItemCaseSensitive(root, "rate");
+            cJSON* jch = cJSON_GetObjectItemCaseSensitive(root, "channels");
+            cJSON* jamp = cJSON_GetObjectItemCaseSensitive(root, "amp");
+            if (cJSON_IsString(jpath) && jpath->valuestring) r.name = jpath->valuestring;
+            if (cJSON_IsNumber(jrate)) r.rate = (ma_uint32)jrate->valuedouble;
+            if (cJSON_IsNumber(jch)) r.channels = (ma_uint32)jch->valuedouble;
+            if (cJSON_IsNumber(jamp)) r.amp = (float)jamp->valuedouble;
+            parse_reverb_request(root, r.reverb);
+            parse_channel_layout(root, &r.channels, r.layout);
+            cJSON_Delete(root);
+        }
     }
-    if (g_noiseDeviceInited) {
-        ma_device_uninit(&g_noiseDevice);
-        g_noiseDeviceInited = false;
+    if (r.channels == 0 || r.channels > DSP_MAX_CHANNELS) r.channels = 2;
+    if (r.rate < 8000) r.rate = 8000;
+    if (r.amp < 0.0f) r.amp = 0.0f;
+    if (r.amp > 1.0f) r.amp = 1.0f;
+    finish_channel_layout(r.layout, r.channels);
+    return r;
+}
+
+// Decode (or fetch from the cache) and start a clip on the session. Returns an HTTP
+// status: 400 for a bad path, 404 if the clip cannot be decoded, 500 if playback fails.
+static int play_clip(const std::shared_ptr<PlaybackSession>& session, const ClipRequest& r) {
+    std::string path;
+    if (!resolve_clip_path(r.name, path)) return 400;
+    auto clip = clip_cache_get(g_clipCache, path, ma_format_f32, r.channels, r.rate);
+    if (!clip) return 404;
+    ReverbSpec reverb;
+    int status = resolve_reverb(r.reverb, r.rate, &reverb);
+    if (status != 200) return status;
+    ma_uint32 duration_ms = (ma_uint32)((clip->frameCount * 1000 + r.rate - 1) / r.rate);
+    if (duration_ms < 1) duration_ms = 1;
+    return start_playback(session, r.rate, r.channels, r.layout, r.amp, DSP_NOISE_WHITE, 0, NoiseFilter{}, reverb, duration_ms, clip) ? 200 : 500;
+}
+
+static int play_noise(const std::shared_ptr<PlaybackSession>& session, const NoiseRequest& r) {
+    ReverbSpec reverb;
+    int status = resolve_reverb(r.reverb, r.rate, &reverb);
+    if (status != 200) return status;
+    return start_noise(session, r.rate, r.channels, r.layout, r.amp, r.color, r.seed, r.filter, reverb, r.duration_ms) ? 200 : 500;
+}
+
+static ma_uint32 crossfade_ms_from_request(const httplib::Request& req) {
+    ma_uint32 crossfadeMs = kDefaultCrossfadeMs;
+    try { if (req.has_param("crossfade_ms")) crossfadeMs = (ma_uint32)std::stoul(req.get_param_value("crossfade_ms")); } catch(...) {}
+    if (crossfadeMs > 2000) crossfadeMs = 2000;
+    return crossfadeMs;
+}
+
+// Look up the session named by the route's first capture, or answer 404.
+static std::shared_ptr<PlaybackSession> session_from_route(const httplib::Request& req, httplib::Response& res) {
+    auto s = find_session(req.matches[1]);
+    if (!s) {
+        res.status = 404;
+        res.set_content("{\"error\":\"unknown session\"}", "application/json");
     }
-    g_hasDeadline = false;
+    return s;
+}
+
+static void print_usage(const char* exe) {
+    fprintf(stderr, "Usage: %s [--port N] [--null-backend] [--loopback] [--fixed-point | --float]\n", exe);
+    fprintf(stderr, "  --port: HTTP port (default 8080)\n");
+    fprintf(stderr, "  --null-backend: use miniaudio's null backend; implies --loopback (also ALGORYTHM_NULL_BACKEND=1)\n");
+    fprintf(stderr, "  --loopback: keep each session's rendered output in memory for /audio/sessions/{id}/loopback\n");
+    fprintf(stderr, "  --fixed-point, --float: generate live streams with the Q15 integer or the float generators (default %s)\n",
+        g_fixedPoint ? "fixed point" : "float");
+    fprintf(stderr, "  ALGORYTHM_DSP_PATH=scalar|sse2|avx2|neon forces a DSP kernel path (default: fastest supported)\n");
 }
 
-int main() {
+int main(int argc, char** argv) {
+    int port = 8080;
+    if (const char* env = getenv("ALGORYTHM_NULL_BACKEND")) {
+        g_nullBackend = env[0] != '\0' && strcmp(env, "0") != 0;
+    }
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = (int)strtol(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--null-backend") == 0) {
+            g_nullBackend = true;
+        } else if (strcmp(argv[i], "--loopback") == 0) {
+            g_loopbackEnabled = true;
+        } else if (strcmp(argv[i], "--fixed-point") == 0) {
+            g_fixedPoint = true;
+        } else if (strcmp(argv[i], "--float") == 0) {
+            g_fixedPoint = false;
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (g_nullBackend) g_loopbackEnabled = true;
+
+    // Bind DSP kernels before any audio or worker thread can run them.
+    if (dsp_init() != 0) {
+        fprintf(stderr, "ALGORYTHM_DSP_PATH not available here; using %s kernels.\n", dsp_path_name(dsp_active_path()));
+    }
     ensure_audio_context();
+    g_clipCache.capacityBytes = kClipCacheBytes;
+    default_session();
+    load_device_selection();
+    device_watcher_start();
+    loudness_worker_start();
 
     httplib::Server svr;
+    svr.new_task_queue = [] { return new httplib::ThreadPool(kMaxStreamClients + kRequestThreads); };
 
     // Serve static assets placed in build root: build/static_html
     svr.set_mount_point("/", "static_html");
@@ -258,70 +2720,405 @@ int main() {
         res.set_content(render_ble_list(), "text/html; charset=utf-8");
     });
 
+    // Device list change notifications as Server-Sent Events
+    svr.Get("/audio/events", [](const httplib::Request&, httplib::Response& res) {
+        if (!stream_client_acquire(res)) return;
+        res.set_header("Cache-Control", "no-cache");
+        auto cursor = std::make_shared<ma_uint64>(0);
+        res.set_chunked_content_provider("text/event-stream", [cursor](size_t, httplib::DataSink& sink) {
+            std::string event;
+            {
+                std::unique_lock<std::mutex> lock(g_deviceWatcher.mutex);
+                bool fresh = g_deviceWatcher.changed.wait_for(lock, std::chrono::seconds(15), [&]() {
+                    return g_deviceWatcher.stop || g_deviceWatcher.version != *cursor;
+                });
+                if (g_deviceWatcher.stop) return false;
+                if (fresh) {
+                    *cursor = g_deviceWatcher.version;
+                    event = "event: devices\ndata: " + std::to_string(*cursor) + "\n\n";
+                }
+            }
+            if (event.empty()) event = ": keepalive\n\n";
+            return sink.write(event.data(), event.size());
+        }, [](bool) { stream_client_release(); });
+    });
+
     // Audio devices list and selection
     svr.Get("/audio/list", [](const httplib::Request&, httplib::Response& res) {
         res.set_content(render_audio_list(), "text/html; charset=utf-8");
     });
 
     svr.Post("/audio/select", [](const httplib::Request& req, httplib::Response& res) {
-        int idx = -1;
-        try { idx = std::stoi(req.get_param_value("index")); } catch(...) { idx = -1; }
-        {
-            std::lock_guard<std::mutex> lock(g_audioMutex);
-            g_selectedPlaybackIndex = idx;
+        DeviceSelection sel;
+        if (!selection_from_request(req, false, &sel)) {
+            res.status = 400;
+            res.set_content(render_audio_list(), "text/html; charset=utf-8");
+            return;
         }
+        select_playback_device(default_session(), sel, crossfade_ms_from_request(req));
+        save_device_selection();
         res.set_content(render_audio_list(), "text/html; charset=utf-8");
     });
 
     // White noise via JSON body
     svr.Post("/audio/whitenoise", [](const httplib::Request& req, httplib::Response& res) {
+        NoiseRequest r = parse_noise_request(req.body);
+        bool ok = play_noise(default_session(), r) == 200;
+        res.set_content(ok ? (std::string("<small>White noise started for ") + std::to_string(r.duration_ms) + " ms</small>") : "<small>Failed to start noise.</small>", "text/html; charset=utf-8");
+    });
+
+    // Stop white noise
+    svr.Post("/audio/whitenoise/stop", [](const httplib::Request&, httplib::Response& res) {
+        stop_noise(*default_session());
+        res.set_content("<small>White noise stopped.</small>", "text/html; charset=utf-8");
+    });
+
+    // Hot standby: keep the output running silent so playback only needs arming
+    svr.Post("/audio/standby", [](const httplib::Request& req, httplib::Response& res) {
+        StandbyRequest r = parse_standby_request(req.body);
+        bool ok = set_standby(*default_session(), r.enabled, r.rate, r.channels, r.layout.map);
+        res.set_content(ok ? (r.enabled ? "<small>Standby on.</small>" : "<small>Standby off.</small>") : "<small>Failed to enter standby.</small>", "text/html; charset=utf-8");
+    });
+
+    // Play a short clip from the clips/ directory via JSON body; decoded PCM is cached.
+    svr.Post("/audio/clip", [](const httplib::Request& req, httplib::Response& res) {
+        int status = play_clip(default_session(), parse_clip_request(req.body));
+        if (status == 400) {
+            res.status = 400;
+            res.set_content("<small>Invalid clip path.</small>", "text/html; charset=utf-8");
+        } else if (status == 404) {
+            res.status = 404;
+            res.set_content("<small>Failed to decode clip.</small>", "text/html; charset=utf-8");
+        } else {
+            res.set_content(status == 200 ? "<small>Clip started.</small>" : "<small>Failed to start clip.</small>", "text/html; charset=utf-8");
+        }
+    });
+
+    // Playback sessions (zones): each drives its own device with independent settings.
+    // The endpoints above act on the "default" session.
+    svr.Get("/audio/sessions", [](const httplib::Request&, httplib::Response& res) {
+        cJSON* root = cJSON_CreateArray();
+        for (auto& s : list_sessions()) cJSON_AddItemToArray(root, session_json(*s));
+        res.set_content(print_json(root), "application/json");
+    });
+
+    svr.Post("/audio/sessions", [](const httplib::Request& req, httplib::Response& res) {
+        std::string id;
+        if (!req.body.empty()) {
+            cJSON* root = cJSON_Parse(req.body.c_str());
+            if (root) {
+                cJSON* jid = cJSON_GetObjectItemCaseSensitive(root, "id");
+                if (cJSON_IsString(jid) && jid->valuestring) id = jid->valuestring;
+                cJSON_Delete(root);
+            }
+        }
+        if (!id.empty() && !valid_session_id(id)) {
+            res.status = 400;
+            res.set_content("{\"error\":\"invalid session id\"}", "application/json");
+            return;
+        }
+        auto s = create_session(id);
+        if (!s) {
+            res.status = 409;
+            res.set_content("{\"error\":\"session exists or limit reached\"}", "application/json");
+            return;
+        }
+        res.status = 201;
+        res.set_content(print_json(session_json(*s)), "application/json");
+    });
+
+    svr.Get(R"(/audio/sessions/([A-Za-z0-9_-]+))", [](const httplib::Request& req, httplib::Response& res) {
+        auto s = session_from_route(req, res);
+        if (!s) return;
+        res.set_content(print_json(session_json(*s)), "application/json");
+    });
+
+    svr.Delete(R"(/audio/sessions/([A-Za-z0-9_-]+))", [](const httplib::Request& req, httplib::Response& res) {
+        if (req.matches[1] == kDefaultSessionId) {
+            res.status = 400;
+            res.set_content("{\"error\":\"the default session cannot be removed\"}", "application/json");
+            return;
+        }
+        if (!remove_session(req.matches[1])) {
+            res.status = 404;
+            res.set_content("{\"error\":\"unknown session\"}", "application/json");
+            return;
+        }
+        res.status = 204;
+    });
+
+    svr.Post(R"(/audio/sessions/([A-Za-z0-9_-]+)/select)", [](const httplib::Request& req, httplib::Response& res) {
+        auto s = session_from_route(req, res);
+        if (!s) return;
+        DeviceSelection sel;
+        if (!selection_from_request(req, false, &sel)) {
+            res.status = 400;
+            res.set_content("{\"error\":\"unknown device\"}", "application/json");
+            return;
+        }
+        if (!select_playback_device(s, sel, crossfade_ms_from_request(req))) res.status = 500;
+        if (s->id == kDefaultSessionId) save_device_selection();
+        res.set_content(print_json(session_json(*s)), "application/json");
+    });
+
+    svr.Post(R"(/audio/sessions/([A-Za-z0-9_-]+)/noise)", [](const httplib::Request& req, httplib::Response& res) {
+        auto s = session_from_route(req, res);
+        if (!s) return;
+        int status = play_noise(s, parse_noise_request(req.body));
+        if (status != 200) res.status = status;
+        res.set_content(print_json(session_json(*s)), "application/json");
+    });
+
+    svr.Post(R"(/audio/sessions/([A-Za-z0-9_-]+)/clip)", [](const httplib::Request& req, httplib::Response& res) {
+        auto s = session_from_route(req, res);
+        if (!s) return;
+        int status = play_clip(s, parse_clip_request(req.body));
+        if (status != 200) res.status = status;
+        res.set_content(print_json(session_json(*s)), "application/json");
+    });
+
+    svr.Post(R"(/audio/sessions/([A-Za-z0-9_-]+)/stop)", [](const httplib::Request& req, httplib::Response& res) {
+        auto s = session_from_route(req, res);
+        if (!s) return;
+        stop_noise(*s);
+        res.set_content(print_json(session_json(*s)), "application/json");
+    });
+
+    svr.Post(R"(/audio/sessions/([A-Za-z0-9_-]+)/standby)", [](const httplib::Request& req, httplib::Response& res) {
+        auto s = session_from_route(req, res);
+        if (!s) return;
+        StandbyRequest r = parse_standby_request(req.body);
+        if (!set_standby(*s, r.enabled, r.rate, r.channels, r.layout.map)) res.status = 500;
+        res.set_content(print_json(session_json(*s)), "application/json");
+    });
+
+    // Loudness normalization: {"target_lufs": -23} to enable, {"target_lufs": null} to disable
+    svr.Post(R"(/audio/sessions/([A-Za-z0-9_-]+)/loudness)", [](const httplib::Request& req, httplib::Response& res) {
+        auto s = session_from_route(req, res);
+        if (!s) return;
+        cJSON* root = cJSON_Parse(req.body.c_str());
+        cJSON* jtarget = root ? cJSON_GetObjectItemCaseSensitive(root, "target_lufs") : nullptr;
+        if (cJSON_IsNumber(jtarget)) {
+            set_loudness_target(*s, true, std::min(std::max((float)jtarget->valuedouble, -70.0f), 0.0f));
+        } else if (cJSON_IsNull(jtarget)) {
+            set_loudness_target(*s, false, s->loudness->targetLufs.load(std::memory_order_relaxed));
+        } else {
+            res.status = 400;
+        }
+        cJSON_Delete(root);
+        res.set_content(print_json(session_json(*s)), "application/json");
+    });
+
+    // Output limiter: {"enabled": true, "ceiling_db": -1}. Enabling resets the meter.
+    svr.Post(R"(/audio/sessions/([A-Za-z0-9_-]+)/limiter)", [](const httplib::Request& req, httplib::Response& res) {
+        auto s = session_from_route(req, res);
+        if (!s) return;
+        cJSON* root = cJSON_Parse(req.body.c_str());
+        if (!root) {
+            res.status = 400;
+        } else {
+            cJSON* jenabled = cJSON_GetObjectItemCaseSensitive(root, "enabled");
+            cJSON* jceiling = cJSON_GetObjectItemCaseSensitive(root, "ceiling_db");
+            if (cJSON_IsNumber(jceiling)) {
+                float db = std::min(std::max((float)jceiling->valuedouble, -24.0f), 0.0f);
+                s->limiter.ceiling.store(std::pow(10.0f, db / 20.0f), std::memory_order_relaxed);
+            }
+            if (cJSON_IsBool(jenabled)) {
+                bool enabled = cJSON_IsTrue(jenabled);
+                if (enabled && !s->limiter.enabled.load(std::memory_order_relaxed)) {
+                    s->limiter.maxGainReductionDb.store(0.0f, std::memory_order_relaxed);
+                    s->limiter.limitedBlocks.store(0, std::memory_order_relaxed);
+                }
+                s->limiter.enabled.store(enabled, std::memory_order_relaxed);
+            }
+            cJSON_Delete(root);
+        }
+        res.set_content(print_json(session_json(*s)), "application/json");
+    });
+
+    // Loopback capture of rendered output (--null-backend or --loopback)
+    svr.Get(R"(/audio/sessions/([A-Za-z0-9_-]+)/loopback)", [](const httplib::Request& req, httplib::Response& res) {
+        auto s = session_from_route(req, res);
+        if (!s) return;
+        size_t hashFrames = 0;
+        try { if (req.has_param("frames")) hashFrames = (size_t)std::stoul(req.get_param_value("frames")); } catch(...) {}
+        res.set_content(render_loopback_json(*s, hashFrames), "application/json");
+    });
+
+    svr.Post(R"(/audio/sessions/([A-Za-z0-9_-]+)/loopback/reset)", [](const httplib::Request& req, httplib::Response& res) {
+        auto s = session_from_route(req, res);
+        if (!s) return;
+        if (!reset_loopback(*s)) res.status = 409;
+        res.set_content(render_loopback_json(*s, 0), "application/json");
+    });
+
+    // Live generated noise as an endless 16-bit PCM or IMA-ADPCM (codec=adpcm) WAV over
+    // chunked transfer encoding, shared by all listeners with the same parameters. With
+    // gen_rate set, noise is generated at that rate and resampled to rate.
+    svr.Get("/audio/stream.wav", [](const httplib::Request& req, httplib::Response& res) {
+        StreamParams params{DSP_NOISE_WHITE, 48000, 0, 2, 0.2f, StreamCodec::Pcm16, false, 0};
+        if (req.has_param("color") && dsp_noise_color_from_name(req.get_param_value("color").c_str(), &params.color) != 0) {
+            res.status = 400;
+            res.set_content("Unknown color", "text/plain");
+            return;
+        }
+        if (req.has_param("codec")) {
+            std::string codec = req.get_param_value("codec");
+            if (codec == "adpcm") {
+                params.codec = StreamCodec::ImaAdpcm;
+            } else if (codec != "pcm") {
+                res.status = 400;
+                res.set_content("Unknown codec", "text/plain");
+                return;
+            }
+        }
+        try { if (req.has_param("rate")) params.rate = (ma_uint32)std::stoul(req.get_param_value("rate")); } catch(...) {}
+        try { if (req.has_param("gen_rate")) params.genRate = (ma_uint32)std::stoul(req.get_param_value("gen_rate")); } catch(...) {}
+        try { if (req.has_param("channels")) params.channels = (ma_uint32)std::stoul(req.get_param_value("channels")); } catch(...) {}
+        try { if (req.has_param("amp")) params.amp = std::stof(req.get_param_value("amp")); } catch(...) {}
+        try {
+            if (req.has_param("seed")) {
+                params.seed = (ma_uint32)std::stoul(req.get_param_value("seed"));
+                params.fixedSeed = true;
+            }
+        } catch(...) {}
+        if (params.channels == 0 || params.channels > DSP_MAX_CHANNELS) params.channels = 2;
+        if (params.rate < 8000) params.rate = 8000;
+        if (params.rate > 192000) params.rate = 192000;
+        if (params.genRate == 0) params.genRate = params.rate;
+        if (params.genRate < 8000) params.genRate = 8000;
+        if (params.genRate > 192000) params.genRate = 192000;
+        if (!(params.amp >= 0.0f)) params.amp = 0.0f;
+        if (params.amp > 1.0f) params.amp = 1.0f;
+
+        if (!stream_client_acquire(res)) return;
+        auto bc = broadcast_acquire(params);
+        if (!bc) {
+            stream_client_release();
+            res.status = 500;
+            res.set_content("Failed to set up resampling", "text/plain");
+            return;
+        }
+        auto cursor = std::make_shared<ma_uint64>(0);
+        res.set_header("Cache-Control", "no-cache");
+        res.set_chunked_content_provider("audio/wav", [bc, cursor](size_t offset, httplib::DataSink& sink) {
+            if (offset == 0) {
+                ma_uint8 header[kWavHeaderMaxBytes];
+                size_t headerBytes = write_wav_header(header, bc->params.rate, (ma_uint16)bc->params.channels, bc->params.codec);
+                if (!sink.write((const char*)header, headerBytes)) return false;
+                std::lock_guard<std::mutex> lock(bc->mutex);
+                *cursor = bc->writeSeq > Broadcast::kLeadBlocks ? bc->writeSeq - Broadcast::kLeadBlocks : 0;
+            }
+            std::shared_ptr<BroadcastBlock> block;
+            if (!broadcast_next(*bc, *cursor, block)) return false;
+            return sink.write(block->bytes.data(), block->bytes.size());
+        }, [bc](bool) {
+            broadcast_release(bc);
+            stream_client_release();
+        });
+    });
+
+    // Capture device list, selection and level metering
+    svr.Get("/audio/capture/list", [](const httplib::Request&, httplib::Response& res) {
+        res.set_content(render_capture_list(), "text/html; charset=utf-8");
+    });
+
+    svr.Post("/audio/capture/select", [](const httplib::Request& req, httplib::Response& res) {
+        DeviceSelection sel;
+        if (!selection_from_request(req, true, &sel)) {
+            res.status = 400;
+            res.set_content(render_capture_list(), "text/html; charset=utf-8");
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(g_audioMutex);
+            g_selectedCapture = sel;
+        }
+        save_device_selection();
+        res.set_content(render_capture_list(), "text/html; charset=utf-8");
+    });
+
+    svr.Post("/audio/capture/start", [](const httplib::Request& req, httplib::Response& res) {
         ma_uint32 rate = 48000;
-        ma_uint32 channels = 2;
-        ma_uint32 duration_ms = 3000;
-        float amp = 0.2f;
+        ma_uint32 channels = 1;
+        ma_uint32 fps = 15;
         if (!req.body.empty()) {
             cJSON* root = cJSON_Parse(req.body.c_str());
             if (root) {
                 cJSON* jrate = cJSON_GetObjectItemCaseSensitive(root, "rate");
                 cJSON* jch = cJSON_GetObjectItemCaseSensitive(root, "channels");
-                cJSON* jdur = cJSON_GetObjectItemCaseSensitive(root, "duration_ms");
-                cJSON* jamp = cJSON_GetObjectItemCaseSensitive(root, "amp");
+                cJSON* jfps = cJSON_GetObjectItemCaseSensitive(root, "spectrum_fps");
                 if (cJSON_IsNumber(jrate)) rate = (ma_uint32)jrate->valuedouble;
                 if (cJSON_IsNumber(jch)) channels = (ma_uint32)jch->valuedouble;
-                if (cJSON_IsNumber(jdur)) duration_ms = (ma_uint32)jdur->valuedouble;
-                if (cJSON_IsNumber(jamp)) amp = (float)jamp->valuedouble;
+                if (cJSON_IsNumber(jfps)) fps = (ma_uint32)jfps->valuedouble;
                 cJSON_Delete(root);
             }
         }
-        if (channels == 0 || channels > 8) channels = 2;
+        if (channels == 0 || channels > 8) channels = 1;
         if (rate < 8000) rate = 8000;
-        if (amp < 0.0f) amp = 0.0f;
-        if (amp > 1.0f) amp = 1.0f;
-        if (duration_ms < 100) duration_ms = 100;
-        bool ok = start_noise(rate, channels, amp, duration_ms);
-        res.set_content(ok ? (std::string("<small>White noise started for ") + std::to_string(duration_ms) + " ms</small>") : "<small>Failed to start noise.</small>", "text/html; charset=utf-8");
+        if (fps < 1) fps = 1;
+        if (fps > 60) fps = 60;
+        bool ok = start_capture(rate, channels, fps);
+        res.set_content(ok ? "<small>Capture started.</small>" : "<small>Failed to start capture.</small>", "text/html; charset=utf-8");
     });
 
-    // Stop white noise
-    svr.Post("/audio/whitenoise/stop", [](const httplib::Request&, httplib::Response& res) {
-        stop_noise();
-        res.set_content("<small>White noise stopped.</small>", "text/html; charset=utf-8");
+    svr.Post("/audio/capture/stop", [](const httplib::Request&, httplib::Response& res) {
+        stop_capture();
+        res.set_content("<small>Capture stopped.</small>", "text/html; charset=utf-8");
+    });
+
+    svr.Get("/audio/capture/levels", [](const httplib::Request&, httplib::Response& res) {
+        res.set_content(render_capture_levels_json(), "application/json");
+    });
+
+    // Spectrum frames of the captured audio as Server-Sent Events
+    svr.Get("/audio/capture/spectrum", [](const httplib::Request&, httplib::Response& res) {
+        if (!stream_client_acquire(res)) return;
+        res.set_header("Cache-Control", "no-cache");
+        auto cursor = std::make_shared<ma_uint64>(0);
+        res.set_chunked_content_provider("text/event-stream", [cursor](size_t, httplib::DataSink& sink) {
+            std::string frame;
+            {
+                std::unique_lock<std::mutex> lock(g_spectrum.mutex);
+                bool fresh = g_spectrum.frameReady.wait_for(lock, std::chrono::seconds(1), [&]() {
+                    return g_spectrum.shutdown || g_spectrum.frameSeq != *cursor;
+                });
+                if (g_spectrum.shutdown) return false;
+                if (fresh) {
+                    *cursor = g_spectrum.frameSeq;
+                    frame = g_spectrum.frame;
+                }
+            }
+            // Comment lines keep idle connections alive and detect closed clients.
+            if (frame.empty()) frame = ": keepalive\n\n";
+            return sink.write(frame.data(), frame.size());
+        }, [](bool) { stream_client_release(); });
+    });
+
+    // Runtime counters as JSON
+    svr.Get("/audio/stats", [](const httplib::Request&, httplib::Response& res) {
+        res.set_content(render_stats_json(), "application/json");
     });
 
     const char* host = "0.0.0.0";
-    int port = 8080;
-    printf("Server listening at http://%s:%d\n", host, port);
+    printf("Server listening at http://%s:%d%s\n", host, port, g_nullBackend ? " (null audio backend)" : "");
     svr.listen(host, port);
 
+    {
+        std::lock_guard<std::mutex> lock(g_spectrum.mutex);
+        g_spectrum.shutdown = true;
+    }
+    g_spectrum.frameReady.notify_all();
+    device_watcher_stop();
+    loudness_worker_stop();
+
     // Cleanup context on exit
     if (g_ctx_inited) {
-        stop_noise();
+        for (auto& s : list_sessions()) close_session(*s);
+        stop_capture();
         ma_context_uninit(&g_ctx);
         g_ctx_inited = false;
     }
-    if (g_monitorRunning.load()) {
-        g_monitorRunning.store(false);
-        if (g_noiseMonitor.joinable()) g_noiseMonitor.join();
-    }
+    timer_queue_stop(g_timers);
     return 0;
 }
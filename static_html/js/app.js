@@ -4,7 +4,8 @@ document.getElementById('noise-form').addEventListener('submit', async (e) => {
     rate: parseInt(document.getElementById('rate').value, 10),
     channels: parseInt(document.getElementById('channels').value, 10),
     duration_ms: parseInt(document.getElementById('duration').value, 10),
-    amp: parseFloat(document.getElementById('amp').value)
+    amp: parseFloat(document.getElementById('amp').value),
+    color: document.getElementById('color').value
   };
   try {
     const res = await fetch('/audio/whitenoise', {
@@ -28,3 +29,35 @@ document.getElementById('noise-stop').addEventListener('click', async () => {
     document.getElementById('noise-result').innerHTML = '<small>Failed to stop noise.</small>';
   }
 });
+
+setInterval(async () => {
+  try {
+    const res = await fetch('/audio/capture/levels');
+    const lv = await res.json();
+    if (!lv.running) return;
+    document.getElementById('capture-levels').innerHTML =
+      `<small>RMS ${lv.rms_dbfs.toFixed(1)} dBFS, peak ${lv.peak_dbfs.toFixed(1)} dBFS, clips ${lv.clips}</small>`;
+  } catch (err) {
+    // ignore transient errors
+  }
+}, 500);
+
+const spectrum = new EventSource('/audio/capture/spectrum');
+spectrum.onmessage = (e) => {
+  const bins = JSON.parse(e.data);
+  const canvas = document.getElementById('spectrum');
+  const ctx = canvas.getContext('2d');
+  const w = canvas.width / bins.length;
+  ctx.clearRect(0, 0, canvas.width, canvas.height);
+  ctx.fillStyle = '#1095c1';
+  bins.forEach((db, i) => {
+    const h = Math.max(0, (db + 120) / 120) * canvas.height;
+    ctx.fillRect(i * w, canvas.height - h, w - 1, h);
+  });
+};
+
+// Device lists refresh only when the server reports a change.
+const deviceEvents = new EventSource('/audio/events');
+deviceEvents.addEventListener('devices', () => {
+  document.body.dispatchEvent(new Event('audio-devices-changed'));
+});